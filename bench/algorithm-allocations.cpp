@@ -0,0 +1,140 @@
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <insertionfinder/algorithm.hpp>
+#include <insertionfinder/case.hpp>
+#include <insertionfinder/case-file.hpp>
+#include <insertionfinder/cube.hpp>
+#include <insertionfinder/finder/brute-force.hpp>
+#include <insertionfinder/finder/finder.hpp>
+#include <insertionfinder/finder/greedy.hpp>
+using std::size_t;
+using InsertionFinder::Algorithm;
+using InsertionFinder::BruteForceFinder;
+using InsertionFinder::Case;
+using InsertionFinder::CaseFile;
+using InsertionFinder::CaseStreamError;
+using InsertionFinder::Cube;
+using InsertionFinder::Finder;
+using InsertionFinder::GreedyFinder;
+
+
+namespace {
+    std::atomic<size_t> allocations = 0;
+
+    struct Search {
+        const char* name;
+        const char* scramble;
+        const char* skeleton;
+        bool optimal;
+    };
+
+    constexpr const char* scramble = "R' U' F L2 D2 U' R2 U B2 U L2 U' F2 R' B' D L' F' U2 B D' F U' R' U' F";
+    constexpr Search searches[] = {
+        {
+            "greedy, 2 corner cycles + 1 edge cycle", scramble,
+            "F' U R U F' D B' U2 F L D' B R F2 U L2 U' B2 U' R2 U D2 L2 F' U R R U R' D R U' R' D' "
+            "F R F' L F R' F' L' R2 U R U R' U' R' U' R' U R'",
+            false
+        },
+        {
+            "greedy, 2 corner cycles", scramble,
+            "F' U R U F' D B' U2 F L D' B R F2 U L2 U' B2 U' R2 U D2 L2 F' U R R U R' D R U' R' D' "
+            "F R F' L F R' F' L'",
+            false
+        },
+        {
+            "optimal, 1 corner cycle + 1 edge cycle", scramble,
+            "F' U R U F' D B' U2 F L D' B R F2 U L2 U' B2 U' R2 U D2 L2 F' U R R U R' D R U' R' D' "
+            "R2 U R U R' U' R' U' R' U R'",
+            true
+        }
+    };
+
+    template<class F> void report(const std::string& name, F&& f) {
+        size_t before = allocations;
+        auto begin = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        std::cout << name << ": " << allocations - before << " allocations, "
+            << std::chrono::duration<double, std::milli>(end - begin).count() << " ms" << std::endl;
+    }
+};
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " algfile..." << std::endl;
+        return 1;
+    }
+    std::vector<Case> cases;
+    report("load cases", [&]() {
+        std::unordered_map<Cube, Case> map;
+        for (int i = 1; i < argc; ++i) {
+            CaseFile file(argv[i]);
+            std::vector<Case> file_cases;
+            try {
+                if (file.fail()) {
+                    throw CaseStreamError();
+                }
+                file.read_cases(file_cases);
+            } catch (const CaseStreamError& e) {
+                std::cerr << "Invalid algorithm file " << argv[i] << std::endl;
+            }
+            for (Case& _case: file_cases) {
+                auto [node, inserted] = map.try_emplace(_case.get_state(), std::move(_case));
+                if (!inserted) {
+                    node->second.merge_algorithms(std::move(_case));
+                }
+            }
+        }
+        cases.reserve(map.size());
+        for (auto& node: map) {
+            cases.emplace_back(std::move(node.second));
+            cases.back().drop_algorithm_index();
+        }
+        std::sort(cases.begin(), cases.end(), [](const Case& x, const Case& y) {return Case::compare(x, y) < 0;});
+    });
+
+    size_t sink = 0;
+    for (const Search& search: searches) {
+        report(search.name, [&]() {
+            Algorithm scramble(search.scramble);
+            Algorithm skeleton(search.skeleton);
+            std::unique_ptr<Finder> finder;
+            if (search.optimal) {
+                finder = std::make_unique<BruteForceFinder>(scramble, skeleton, cases);
+            } else {
+                finder = std::make_unique<GreedyFinder>(scramble, skeleton, cases, GreedyFinder::Options {false, 2, 0});
+            }
+            finder->search({std::numeric_limits<size_t>::max(), 1.5, 1});
+            sink += finder->get_fewest_moves();
+        });
+    }
+    return sink == 0;
+}
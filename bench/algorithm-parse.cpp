@@ -0,0 +1,60 @@
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <insertionfinder/algorithm.hpp>
+using std::size_t;
+using InsertionFinder::Algorithm;
+
+
+namespace {
+    constexpr size_t rounds = 20;
+    constexpr size_t repeats = 100;
+
+    template<class F> double measure(size_t operations, F&& f) {
+        double best = 0;
+        for (size_t round = 0; round < rounds; ++round) {
+            auto begin = std::chrono::steady_clock::now();
+            f();
+            auto end = std::chrono::steady_clock::now();
+            double duration = std::chrono::duration<double, std::nano>(end - begin).count() / operations;
+            best = round == 0 ? duration : std::min(best, duration);
+        }
+        return best;
+    }
+};
+
+
+int main(int argc, char** argv) {
+    std::vector<std::string> lines;
+    size_t bytes = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream fin(argv[i]);
+        std::string line;
+        while (std::getline(fin, line)) {
+            bytes += line.size();
+            lines.push_back(std::move(line));
+        }
+    }
+    if (lines.empty()) {
+        std::cerr << "Usage: " << argv[0] << " txtfile..." << std::endl;
+        return 1;
+    }
+
+    size_t sink = 0;
+    double parse = measure(lines.size() * repeats, [&]() {
+        for (size_t repeat = 0; repeat < repeats; ++repeat) {
+            for (const std::string& line: lines) {
+                sink += Algorithm(line).length();
+            }
+        }
+    });
+
+    std::cout << "lines: " << lines.size() << " (" << bytes << " bytes)" << std::endl;
+    std::cout << "parse: " << parse << " ns per line, "
+        << bytes / (parse * lines.size()) * 1000 << " MB/s" << std::endl;
+    return sink == 0;
+}
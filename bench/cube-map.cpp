@@ -0,0 +1,101 @@
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <insertionfinder/case.hpp>
+#include <insertionfinder/case-file.hpp>
+#include <insertionfinder/cube.hpp>
+#include <insertionfinder/twist.hpp>
+using std::size_t;
+using InsertionFinder::Case;
+using InsertionFinder::CaseFile;
+using InsertionFinder::CaseStreamError;
+using InsertionFinder::Cube;
+using InsertionFinder::Twist;
+
+
+namespace {
+    constexpr size_t rounds = 20;
+
+    template<class F> double measure(size_t operations, F&& f) {
+        double best = 0;
+        for (size_t round = 0; round < rounds; ++round) {
+            auto begin = std::chrono::steady_clock::now();
+            f();
+            auto end = std::chrono::steady_clock::now();
+            double duration = std::chrono::duration<double, std::nano>(end - begin).count() / operations;
+            best = round == 0 ? duration : std::min(best, duration);
+        }
+        return best;
+    }
+
+    std::vector<Case> read_cases(const std::string& name) {
+        std::vector<Case> cases;
+        CaseFile file(name);
+        try {
+            if (file.fail()) {
+                throw CaseStreamError();
+            }
+            file.read_cases(cases);
+        } catch (const CaseStreamError& e) {
+            std::cerr << "Invalid algorithm file " << name << std::endl;
+        }
+        return cases;
+    }
+};
+
+
+int main(int argc, char** argv) {
+    std::vector<Cube> cubes;
+    for (int i = 1; i < argc; ++i) {
+        for (const Case& _case: read_cases(argv[i])) {
+            cubes.push_back(_case.get_state());
+        }
+    }
+    if (cubes.empty()) {
+        std::cerr << "Usage: " << argv[0] << " algfile..." << std::endl;
+        return 1;
+    }
+    std::vector<Cube> missing;
+    for (const Cube& cube: cubes) {
+        missing.push_back(cube * Twist(1));
+    }
+
+    size_t sink = 0;
+    double insert = measure(cubes.size(), [&]() {
+        std::unordered_map<Cube, size_t> map;
+        for (size_t i = 0; i < cubes.size(); ++i) {
+            map.try_emplace(cubes[i], i);
+        }
+        sink += map.size();
+    });
+    std::unordered_map<Cube, size_t> map;
+    for (size_t i = 0; i < cubes.size(); ++i) {
+        map.try_emplace(cubes[i], i);
+    }
+    double hit = measure(cubes.size(), [&]() {
+        for (const Cube& cube: cubes) {
+            sink += map.find(cube)->second;
+        }
+    });
+    double miss = measure(missing.size(), [&]() {
+        for (const Cube& cube: missing) {
+            sink += map.count(cube);
+        }
+    });
+    size_t largest_bucket = 0;
+    for (size_t bucket = 0; bucket < map.bucket_count(); ++bucket) {
+        largest_bucket = std::max(largest_bucket, map.bucket_size(bucket));
+    }
+
+    std::cout << "cubes: " << cubes.size() << " (" << map.size() << " distinct)" << std::endl;
+    std::cout << "insert: " << insert << " ns" << std::endl;
+    std::cout << "lookup hit: " << hit << " ns" << std::endl;
+    std::cout << "lookup miss: " << miss << " ns" << std::endl;
+    std::cout << "largest bucket: " << largest_bucket << " of " << map.bucket_count() << " buckets" << std::endl;
+    return sink == 0;
+}
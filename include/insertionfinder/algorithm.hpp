@@ -8,8 +8,10 @@
 #include <ostream>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
+#include <insertionfinder/small-vector.hpp>
 #include <insertionfinder/twist.hpp>
 
 namespace InsertionFinder {class Algorithm;};
@@ -40,14 +42,26 @@ namespace InsertionFinder {
     };
 
     class InsertionAlgorithm;
+    class CaseFile;
+    class InsertionMaskList;
+    class SkeletonStore;
+    using InsertionBitmap = Details::SmallVector<std::uint64_t, 8>;
 
     class Algorithm {
         friend struct std::hash<Algorithm>;
+        friend class CaseFile;
+        friend class SkeletonStore;
+    public:
+        static constexpr std::size_t inline_capacity = 32;
     protected:
-        std::vector<Twist> twists;
+        Details::SmallVector<Twist, inline_capacity> twists;
         Rotation rotation;
+        // set only when the twists are known to have no moves left to cancel
+        bool cancelled = false;
+        // sum of twists[i] * 31^(length - 1 - i), so that hashing and comparison can skip the twists
+        std::size_t fingerprint;
     public:
-        Algorithm(): rotation(0) {}
+        Algorithm(): rotation(0), fingerprint(0) {}
         Algorithm(const Algorithm&) = default;
         Algorithm(Algorithm&&) = default;
         Algorithm& operator=(const Algorithm&) = default;
@@ -68,10 +82,11 @@ namespace InsertionFinder {
     public:
         static int compare(const Algorithm& lhs, const Algorithm& rhs) noexcept;
         bool operator==(const Algorithm& rhs) const noexcept {
-            return this->rotation == rhs.rotation && this->twists == rhs.twists;
+            return this->fingerprint == rhs.fingerprint && this->rotation == rhs.rotation
+                && this->twists == rhs.twists;
         }
         bool operator!=(const Algorithm& rhs) const noexcept {
-            return this->rotation != rhs.rotation || this->twists != rhs.twists;
+            return !(*this == rhs);
         }
         bool operator<(const Algorithm& rhs) const noexcept {
             return Algorithm::compare(*this, rhs) < 0;
@@ -95,25 +110,32 @@ namespace InsertionFinder {
         void save_to(std::ostream& out) const;
         virtual void read_from(std::istream& in);
     public:
+        // the templates only convert non-algorithm operands, so that adding two algorithms is never ambiguous
         Algorithm operator+(const Algorithm& rhs) const;
-        template<class T> Algorithm operator+(T&& rhs) const {
+        template<class T, std::enable_if_t<!std::is_base_of_v<Algorithm, std::decay_t<T>>, int> = 0>
+        Algorithm operator+(T&& rhs) const {
             return *this + Algorithm(std::forward<T>(rhs));
         }
         friend Algorithm operator+(Algorithm&& lhs, const Algorithm& rhs) {
             return std::move(lhs += rhs);
         }
-        template<class T> friend Algorithm operator+(T&& lhs, const Algorithm& rhs) {
+        template<class T, std::enable_if_t<!std::is_base_of_v<Algorithm, std::decay_t<T>>, int> = 0>
+        friend Algorithm operator+(T&& lhs, const Algorithm& rhs) {
             return Algorithm(std::forward<T>(lhs)) + rhs;
         }
         Algorithm& operator+=(const Algorithm& rhs);
-        template<class T> Algorithm& operator+=(T&& rhs) {
+        template<class T, std::enable_if_t<!std::is_base_of_v<Algorithm, std::decay_t<T>>, int> = 0>
+        Algorithm& operator+=(T&& rhs) {
             return *this += Algorithm(std::forward<T>(rhs));
         }
         Algorithm operator+(Twist twist) const {
             return Algorithm(*this) += twist;
         }
         Algorithm& operator+=(Twist twist) {
-            this->twists.push_back(twist / this->rotation);
+            twist /= this->rotation;
+            this->twists.push_back(twist);
+            this->fingerprint = this->fingerprint * 31 + twist;
+            this->cancelled = false;
             return *this;
         }
         Algorithm operator+(Rotation rotation) const {
@@ -124,12 +146,25 @@ namespace InsertionFinder {
             return *this;
         }
     private:
+        static std::size_t fingerprint_power(std::size_t exponent) noexcept;
+        void rehash() noexcept;
         std::size_t cancel_moves() noexcept;
+        // the twists before begin and the twists from end on must each be cancelled already
+        std::size_t cancel_moves(std::size_t begin, std::size_t end) noexcept;
         std::vector<int> cancel_moves_return_marks();
     public:
         void detect_rotation() noexcept;
         std::pair<std::uint32_t, std::uint32_t> get_insert_place_mask(std::size_t insert_place) const;
+        // The result is cancelled as a whole. Only the moves around the insert place are cancelled again
+        // when the receiver is already cancelled (after simplify() or as the result of another insertion),
+        // otherwise the whole result goes through cancellation.
         std::pair<Algorithm, std::size_t> insert(const Algorithm& insertion, std::size_t insert_place) const;
+        std::size_t insert_into(Algorithm& result, const Algorithm& insertion, std::size_t insert_place) const;
+        std::size_t insert_length(const Algorithm& insertion, std::size_t insert_place) const;
+        std::size_t insert_length(
+            const InsertionAlgorithm& insertion, std::size_t insert_place,
+            std::pair<std::uint32_t, std::uint32_t> insert_place_mask
+        ) const;
         std::tuple<Algorithm, std::vector<int>, std::vector<int>>
         insert_return_marks(const Algorithm& insertion, std::size_t insert_place) const;
         std::tuple<Algorithm, std::vector<int>, std::vector<std::vector<int>>>
@@ -142,14 +177,17 @@ namespace InsertionFinder {
             std::pair<std::uint32_t, std::uint32_t> insert_place_mask,
             std::size_t fewest_twists = std::numeric_limits<std::size_t>::max()
         ) const;
+        void find_worthy_insertions(
+            const InsertionMaskList& insertions, std::size_t insert_place,
+            std::pair<std::uint32_t, std::uint32_t> insert_place_mask,
+            std::size_t fewest_twists, InsertionBitmap& bitmap
+        ) const;
     public:
         bool swappable(std::size_t place) const {
             return place > 0 && place < this->twists.size()
                 && this->twists[place - 1] >> 3 == this->twists[place] >> 3;
         }
-        void swap_adjacent(std::size_t place) {
-            std::swap(this->twists[place - 1], this->twists[place]);
-        }
+        void swap_adjacent(std::size_t place) noexcept;
     public:
         void simplify() noexcept {
             this->rotation = 0;
@@ -170,6 +208,8 @@ namespace InsertionFinder {
 
     class InsertionAlgorithm: public Algorithm {
         friend class Algorithm;
+        friend class CaseFile;
+        friend class InsertionMaskList;
     private:
         std::uint32_t begin_mask;
         std::uint32_t end_mask;
@@ -181,9 +221,32 @@ namespace InsertionFinder {
         InsertionAlgorithm& operator=(const InsertionAlgorithm&) = default;
         InsertionAlgorithm& operator=(InsertionAlgorithm&&) = default;
         ~InsertionAlgorithm() = default;
-        InsertionAlgorithm(const Algorithm& algorithm): Algorithm(algorithm) {}
-        InsertionAlgorithm(Algorithm&& algorithm): Algorithm(std::move(algorithm)) {}
+        InsertionAlgorithm(const Algorithm& algorithm): Algorithm(algorithm) {
+            this->compute_masks();
+        }
+        InsertionAlgorithm(Algorithm&& algorithm): Algorithm(std::move(algorithm)) {
+            this->compute_masks();
+        }
     public:
         void read_from(std::istream& in) override;
+    private:
+        void compute_masks() noexcept;
+    };
+
+    // Masks and lengths of an algorithm list in parallel arrays,
+    // so that one insert place can be tested against all of them at once.
+    class InsertionMaskList {
+        friend class Algorithm;
+    private:
+        std::vector<std::uint32_t> begin_masks;
+        std::vector<std::uint32_t> end_masks;
+        std::vector<std::uint32_t> set_up_masks;
+        std::vector<std::uint32_t> lengths;
+    public:
+        std::size_t size() const noexcept {
+            return this->lengths.size();
+        }
+        void push_back(const InsertionAlgorithm& algorithm);
+        void assign(const std::vector<InsertionAlgorithm>& algorithms);
     };
 };
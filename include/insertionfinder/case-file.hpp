@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <insertionfinder/case.hpp>
+
+namespace InsertionFinder {
+    // An .algs file mapped into memory.
+    // Version 1 is a varuint case count followed by the cases as written by Case::save_to.
+    // Version 2 starts with a header and stores cases, insertions and twists in fixed-width tables, along with the
+    // cycle counts and insertion masks that version 1 recomputes on load, so reading it is a series of copies.
+    class CaseFile {
+    public:
+        static constexpr int latest_version = 2;
+        class Writer;
+    private:
+        std::shared_ptr<const char> data;
+        std::size_t size = 0;
+        bool failed = true;
+    public:
+        explicit CaseFile(const std::string& path);
+    public:
+        bool fail() const noexcept {
+            return this->failed;
+        }
+        int version() const noexcept;
+        std::uint64_t content_hash() const noexcept;
+        void read_cases(std::vector<Case>& cases) const;
+        static void save_to(std::ostream& out, const std::vector<Case>& cases, int version = latest_version);
+    private:
+        void read_cases_v1(std::vector<Case>& cases) const;
+        void read_cases_v2(std::vector<Case>& cases) const;
+        static void save_to_v2(std::ostream& out, const std::vector<Case>& cases);
+        static void write_header(
+            std::ostream& out,
+            std::uint64_t case_count, std::uint64_t algorithm_count, std::uint64_t twist_count
+        );
+        static void write_case_record(std::ostream& out, const Case& _case, std::uint64_t first_algorithm);
+        static std::uint64_t write_algorithm_records(std::ostream& out, const Case& _case, std::uint64_t first_twist);
+        static void write_twists(std::ostream& out, const Case& _case);
+    };
+
+    // Writes an .algs file one case at a time, so that the whole case set never has to be in memory.
+    // Cases must arrive in their final order. The tables are buffered in temporary files named after
+    // temporary_path until finish() writes the file to out.
+    class CaseFile::Writer {
+    private:
+        int version;
+        std::string temporary_path;
+        std::ofstream case_table;
+        std::ofstream algorithm_table;
+        std::ofstream twist_table;
+        std::uint64_t case_count = 0;
+        std::uint64_t algorithm_count = 0;
+        std::uint64_t twist_count = 0;
+    public:
+        Writer(const std::string& temporary_path, int version = latest_version);
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        ~Writer();
+    public:
+        void write(const Case& _case);
+        void finish(std::ostream& out);
+    private:
+        std::string table_path(const char* table) const {
+            return this->temporary_path + "." + table;
+        }
+    };
+};
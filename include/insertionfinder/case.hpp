@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <algorithm>
 #include <exception>
@@ -18,9 +19,14 @@ namespace InsertionFinder {
     };
 
     class Case {
+        friend class CaseFile;
     private:
         Cube state;
         std::vector<InsertionAlgorithm> list;
+        InsertionMaskList insertion_masks;
+        // open-addressing table of list positions plus one, built once the list grows long enough to be worth it
+        std::vector<std::uint32_t> algorithm_index;
+        static constexpr std::size_t min_indexed_size = 16;
     private:
         std::uint64_t mask;
         bool parity;
@@ -70,22 +76,47 @@ namespace InsertionFinder {
         const std::vector<InsertionAlgorithm>& algorithm_list() const noexcept {
             return this->list;
         }
+        const InsertionMaskList& get_insertion_masks() const noexcept {
+            return this->insertion_masks;
+        }
     public:
         bool contains_algorithm(const Algorithm& algorithm) const noexcept {
-            return std::find(this->list.cbegin(), this->list.cend(), algorithm) != this->list.cend();
+            if (this->algorithm_index.empty()) {
+                return std::find(this->list.cbegin(), this->list.cend(), algorithm) != this->list.cend();
+            }
+            return this->algorithm_index[this->find_algorithm_slot(algorithm)];
         }
         template<class T> void add_algorithm(T&& algorithm) {
+            if (this->algorithm_index.empty() && this->list.size() >= min_indexed_size) {
+                this->build_algorithm_index(this->list.size() + 1);
+            }
             if (!this->contains_algorithm(algorithm)) {
                 this->list.emplace_back(std::forward<T>(algorithm));
+                this->insertion_masks.push_back(this->list.back());
+                if (!this->algorithm_index.empty()) {
+                    this->index_algorithm(this->list.size() - 1);
+                }
             }
         }
         void merge_algorithms(Case&& from) {
+            if (this->list.size() + from.list.size() > min_indexed_size) {
+                this->build_algorithm_index(this->list.size() + from.list.size());
+            }
             for (InsertionAlgorithm& algorithm: from.list) {
                 this->add_algorithm(std::move(algorithm));
             }
         }
-        void sort_algorithms() noexcept {
+        void sort_algorithms() {
             std::sort(this->list.begin(), this->list.end());
+            this->insertion_masks.assign(this->list);
+            this->drop_algorithm_index();
+        }
+        void drop_algorithm_index() noexcept {
+            std::vector<std::uint32_t>().swap(this->algorithm_index);
         }
+    private:
+        std::size_t find_algorithm_slot(const Algorithm& algorithm) const noexcept;
+        void build_algorithm_index(std::size_t capacity);
+        void index_algorithm(std::size_t index);
     };
 };
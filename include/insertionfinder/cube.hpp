@@ -7,7 +7,6 @@
 #include <functional>
 #include <initializer_list>
 #include <istream>
-#include <optional>
 #include <ostream>
 #include <vector>
 #include <insertionfinder/algorithm.hpp>
@@ -34,6 +33,7 @@ namespace InsertionFinder {
 
     class Cube {
         friend struct std::hash<Cube>;
+        friend class CubeBatch;
     private:
         class RawConstructor {};
         static constexpr RawConstructor raw_construct {};
@@ -47,13 +47,18 @@ namespace InsertionFinder {
             2, 1, 3, 1
         };
     private:
-        unsigned corner[8];
-        unsigned edge[12];
+        alignas(16) static constexpr std::uint8_t identity_edge[16] = {
+            0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+        };
+        alignas(8) static constexpr std::uint8_t identity_corner[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    private:
+        alignas(16) std::uint8_t edge[16];
+        alignas(8) std::uint8_t corner[8];
         Rotation _placement;
     public:
-        Cube() noexcept:
-            corner {0, 3, 6, 9, 12, 15, 18, 21},
-            edge {0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22},
+        constexpr Cube() noexcept:
+            edge {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+            corner {0, 1, 2, 3, 4, 5, 6, 7},
             _placement(0) {}
         Cube(const Cube&) = default;
         Cube(Cube&&) = default;
@@ -65,24 +70,43 @@ namespace InsertionFinder {
     public:
         void save_to(std::ostream& out) const;
         void read_from(std::istream& in);
+        void save_to(char data[21]) const noexcept;
+        void read_from(const char data[21]) noexcept;
     public:
-        static int compare(const Cube& lhs, const Cube& rhs) noexcept {
-            return std::memcmp(&lhs, &rhs, sizeof(Cube));
-        }
+        static int compare(const Cube& lhs, const Cube& rhs) noexcept;
         bool operator==(const Cube& rhs) const noexcept {
-            return std::memcmp(this, &rhs, sizeof(Cube)) == 0;
+            std::uint64_t lhs_words[3];
+            std::uint64_t rhs_words[3];
+            std::memcpy(lhs_words, this->edge, 16);
+            std::memcpy(lhs_words + 2, this->corner, 8);
+            std::memcpy(rhs_words, rhs.edge, 16);
+            std::memcpy(rhs_words + 2, rhs.corner, 8);
+            return ((lhs_words[0] ^ rhs_words[0]) | (lhs_words[1] ^ rhs_words[1]) | (lhs_words[2] ^ rhs_words[2])) == 0
+                && this->_placement == rhs._placement;
         }
         bool operator!=(const Cube& rhs) const noexcept {
-            return std::memcmp(this, &rhs, sizeof(Cube)) != 0;
+            return !(*this == rhs);
+        }
+    private:
+        // Edge items only use the low five bits of each byte and edges 12 to 15 never move,
+        // so the corners and the placement fit into the spare bits and the state packs losslessly into 128 bits.
+        std::array<std::uint64_t, 2> packed() const noexcept {
+            std::uint64_t corner;
+            std::uint64_t edge[2];
+            std::memcpy(&corner, this->corner, 8);
+            std::memcpy(edge, this->edge, 16);
+            return {
+                edge[0] | (corner & 0x0707070707070707) << 5,
+                (edge[1] & 0xffffffff) | static_cast<std::uint64_t>(this->_placement) << 32
+                    | (corner >> 4 & 0x0303030303030303) << 5
+            };
         }
     private:
         static const std::array<Cube, 24> rotation_cube;
-        static const std::vector<std::array<int, 24>> corner_cycle_transform;
-        static const std::vector<std::array<int, 24>> edge_cycle_transform;
+        static const std::array<std::array<std::int16_t, 24>, 6 * 24 * 24> corner_cycle_transform;
+        static const std::array<std::array<std::int16_t, 24>, 10 * 24 * 24> edge_cycle_transform;
     private:
-        static std::array<Cube, 24> generate_rotation_cube_table() noexcept;
-        static std::vector<std::array<int, 24>> generate_corner_cycle_transform_table();
-        static std::vector<std::array<int, 24>> generate_edge_cycle_transform_table();
+        static constexpr std::array<Cube, 24> generate_rotation_cube_table() noexcept;
     public:
         void twist(const Algorithm& algorithm, std::byte flags = CubeTwist::full) noexcept {
             this->twist(algorithm, 0, algorithm.length(), flags);
@@ -114,6 +138,12 @@ namespace InsertionFinder {
         void twist(const Cube& cube, std::byte flags = CubeTwist::full) noexcept;
         void twist_before(Twist twist, std::byte flags = CubeTwist::full) noexcept;
         void twist_before(const Cube& cube, std::byte flags = CubeTwist::full) noexcept;
+        // Specialized on the twist flags so that hot loops skip the untouched piece types without branching.
+        // They are instantiated for all eight flag combinations.
+        template<std::byte flags> void twist(Twist twist) noexcept;
+        template<std::byte flags> void twist(const Cube& cube) noexcept;
+        template<std::byte flags> void twist_before(Twist twist) noexcept;
+        template<std::byte flags> void twist_before(const Cube& cube) noexcept;
         static Cube twist(const Cube& lhs, const Cube& rhs, std::byte lhs_flags, std::byte rhs_flags) noexcept;
         void rotate(Rotation rotation, std::byte flags = CubeTwist::full) noexcept {
             if (rotation) {
@@ -143,6 +173,10 @@ namespace InsertionFinder {
         void inverse() noexcept;
         static Cube inverse(const Cube& cube) noexcept;
         std::uint64_t mask() const noexcept;
+        static const char* kernel_name() noexcept;
+        // Switches all cubes to the named kernel set ("scalar", "sse4" or "avx2") if the CPU supports it,
+        // so that tests can check every set. It must not be called while other threads use cubes.
+        static bool select_kernels(const char* name) noexcept;
     public:
         bool has_parity() const noexcept;
         bool parity() const noexcept {
@@ -154,9 +188,6 @@ namespace InsertionFinder {
             return this->_placement;
         }
         Cube best_placement() const noexcept;
-    private:
-        static std::optional<Cube> corner_cycle_cube(unsigned index);
-        static std::optional<Cube> edge_cycle_cube(unsigned index);
     public:
         int corner_cycle_index() const noexcept;
         int edge_cycle_index() const noexcept;
@@ -185,4 +216,73 @@ namespace InsertionFinder {
         lhs.twist(rhs);
         return std::move(lhs);
     }
+
+    class CubeBatch {
+    public:
+        class Result {
+            friend class CubeBatch;
+        private:
+            std::vector<std::uint8_t> corner;
+            std::vector<std::uint8_t> edge;
+            std::vector<std::byte> flags;
+            std::vector<int> corner_cycles;
+            std::vector<int> edge_cycles;
+            std::vector<int> corner_support_cycles;
+            std::vector<int> edge_support_cycles;
+        public:
+            int get_corner_cycles(std::size_t index) const noexcept {
+                return this->corner_cycles[index];
+            }
+            int get_edge_cycles(std::size_t index) const noexcept {
+                return this->edge_cycles[index];
+            }
+        };
+    private:
+        static constexpr std::size_t max_support_size = 3;
+        static constexpr std::uint16_t no_support = 0xffff;
+        // Cases moving at most max_support_size pieces get their cycle counts by updating the cycle structure
+        // of the twisted state, the others fall back to composing the full state.
+        struct Support {
+            std::uint8_t size;
+            std::uint8_t position[max_support_size];
+            std::uint8_t item[max_support_size];
+        };
+    private:
+        std::size_t count;
+        std::size_t stride;
+        std::vector<std::uint8_t> corner;
+        std::vector<std::uint8_t> edge;
+        std::vector<Support> corner_support;
+        std::vector<Support> edge_support;
+        std::vector<std::uint16_t> corner_support_index;
+        std::vector<std::uint16_t> edge_support_index;
+    public:
+        CubeBatch(): count(0), stride(0) {}
+        explicit CubeBatch(const std::vector<Cube>& cubes);
+    public:
+        std::size_t size() const noexcept {
+            return this->count;
+        }
+        template<class F> void twist_before(const Cube& cube, Result& result, F&& flags) const {
+            result.flags.resize(this->count);
+            std::byte twist_flag {0};
+            for (std::size_t index = 0; index < this->count; ++index) {
+                twist_flag |= result.flags[index] = flags(index);
+            }
+            this->twist_before(cube, result, twist_flag);
+        }
+    private:
+        void twist_before(const Cube& cube, Result& result, std::byte flags) const;
+    };
 };
+
+inline std::size_t std::hash<InsertionFinder::Cube>::operator()(const InsertionFinder::Cube& cube) const noexcept {
+    auto [low, high] = cube.packed();
+    std::uint64_t hash = low ^ high * 0x9e3779b97f4a7c15;
+    hash ^= hash >> 32;
+    hash *= 0xd6e8feb86659fd93;
+    hash ^= hash >> 32;
+    hash *= 0xd6e8feb86659fd93;
+    hash ^= hash >> 32;
+    return hash;
+}
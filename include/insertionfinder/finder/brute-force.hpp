@@ -1,5 +1,6 @@
 #pragma once
 #include <cstddef>
+#include <deque>
 #include <mutex>
 #include <vector>
 #include <insertionfinder/algorithm.hpp>
@@ -15,16 +16,22 @@ namespace InsertionFinder {
         class Worker {
         private:
             BruteForceFinder& finder;
-            std::vector<Insertion> solving_step;
+            // a deque, so that references to the current insertion survive the deeper ones being pushed
+            std::deque<Insertion> solving_step;
+            // one scratch batch per depth, since an insert place keeps its batch while deeper ones are tried
+            std::deque<CubeBatch::Result> case_batches;
+            Algorithm new_skeleton;
         public:
             Worker(BruteForceFinder& finder, const Algorithm& skeleton):
                 finder(finder), solving_step({Insertion(skeleton)}) {}
         public:
             void search(CycleStatus cycle_status, std::size_t begin, std::size_t end);
         private:
+            template<std::byte twist_flag> void search(CycleStatus cycle_status, std::size_t begin, std::size_t end);
             void search_last_corner_cycle(std::size_t begin, std::size_t end);
             void search_last_edge_cycle(std::size_t begin, std::size_t end);
             void search_last_placement(Rotation placement, std::size_t begin, std::size_t end);
+            template<std::byte twist_flag>
             void try_insertion(
                 std::size_t insert_place,
                 const Cube& state,
@@ -51,6 +51,7 @@ namespace InsertionFinder {
         const Algorithm scramble;
         std::unordered_map<Algorithm, std::size_t> skeletons;
         const std::vector<Case>& cases;
+        CubeBatch case_states;
         std::atomic<std::size_t> fewest_moves = std::numeric_limits<std::size_t>::max();
         std::vector<Solution> solutions;
         Result result;
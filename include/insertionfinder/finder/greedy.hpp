@@ -10,6 +10,8 @@
 #include <insertionfinder/algorithm.hpp>
 #include <insertionfinder/case.hpp>
 #include <insertionfinder/cube.hpp>
+#include <insertionfinder/insert-place-table.hpp>
+#include <insertionfinder/skeleton-store.hpp>
 #include <insertionfinder/twist.hpp>
 #include <insertionfinder/finder/finder.hpp>
 
@@ -17,7 +19,7 @@ namespace InsertionFinder {
     class GreedyFinder: public Finder {
     private:
         struct SolvingStep {
-            const Algorithm* skeleton;
+            SkeletonStore::Id skeleton;
             std::size_t insert_place;
             const Algorithm* insertion;
             bool swapped;
@@ -32,25 +34,31 @@ namespace InsertionFinder {
         private:
             GreedyFinder& finder;
             boost::asio::thread_pool& pool;
-            const Algorithm& skeleton;
+            const SkeletonStore::Id skeleton_id;
+            const Algorithm skeleton;
+            InsertPlaceTable place_table;
             const CycleStatus cycle_status;
             const std::size_t cancellation;
+            CubeBatch::Result case_batch;
+            Algorithm new_skeleton;
         public:
             explicit Worker(
                 GreedyFinder& finder,
                 boost::asio::thread_pool& pool,
-                const Algorithm& skeleton,
+                SkeletonStore::Id skeleton_id,
                 CycleStatus cycle_status,
                 std::size_t cancellation
             ):
-                finder(finder), pool(pool), skeleton(skeleton),
-                cycle_status(cycle_status), cancellation(cancellation) {}
+                finder(finder), pool(pool), skeleton_id(skeleton_id), skeleton(finder.skeleton_store[skeleton_id]),
+                place_table(this->skeleton), cycle_status(cycle_status), cancellation(cancellation) {}
         public:
             void search();
         private:
+            template<std::byte twist_flag> void search();
             void search_last_corner_cycle();
             void search_last_edge_cycle();
             void search_last_placement(Rotation placement);
+            template<std::byte twist_flag>
             void try_insertion(std::size_t insert_place, const Cube& state, bool swapped = false);
             void try_last_insertion(std::size_t insert_place, int case_index, bool swapped = false) {
                 if (case_index != -1) {
@@ -67,8 +75,9 @@ namespace InsertionFinder {
         };
     private:
         const Options options;
-        std::vector<std::vector<std::pair<Algorithm, SolvingStep>>> partial_solution_list;
-        std::unordered_map<Algorithm, SolvingStep> partial_solution_map;
+        SkeletonStore skeleton_store;
+        std::vector<std::vector<std::pair<SkeletonStore::Id, SolvingStep>>> partial_solution_list;
+        std::unordered_map<SkeletonStore::Id, SolvingStep> partial_solution_map;
         std::deque<PartialState> partial_states;
         std::mutex worker_mutex;
     public:
@@ -79,6 +88,6 @@ namespace InsertionFinder {
     protected:
         void search_core(const SearchParams& params) override;
     private:
-        void run_worker(boost::asio::thread_pool& pool, Algorithm&& skeleton, const SolvingStep& step);
+        void run_worker(boost::asio::thread_pool& pool, SkeletonStore::Id skeleton, const SolvingStep& step);
     };
 };
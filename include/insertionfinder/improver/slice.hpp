@@ -9,6 +9,8 @@
 #include <insertionfinder/algorithm.hpp>
 #include <insertionfinder/case.hpp>
 #include <insertionfinder/cube.hpp>
+#include <insertionfinder/insert-place-table.hpp>
+#include <insertionfinder/skeleton-store.hpp>
 #include <insertionfinder/twist.hpp>
 #include <insertionfinder/improver/improver.hpp>
 
@@ -16,7 +18,7 @@ namespace InsertionFinder {
     class SliceImprover: public Improver {
     private:
         struct SolvingStep {
-            const Algorithm* skeleton;
+            SkeletonStore::Id skeleton;
             std::size_t insert_place;
             const Algorithm* insertion;
             bool swapped;
@@ -27,17 +29,23 @@ namespace InsertionFinder {
         private:
             SliceImprover& improver;
             boost::asio::thread_pool& pool;
-            const Algorithm& skeleton;
+            const SkeletonStore::Id skeleton_id;
+            const Algorithm skeleton;
+            InsertPlaceTable place_table;
             Rotation placement;
             const std::size_t cancellation;
+            Algorithm new_skeleton;
         public:
             explicit Worker(
                 SliceImprover& improver,
                 boost::asio::thread_pool& pool,
-                const Algorithm& skeleton,
+                SkeletonStore::Id skeleton_id,
                 Rotation placement,
                 std::size_t cancellation
-            ): improver(improver), pool(pool), skeleton(skeleton), placement(placement), cancellation(cancellation) {}
+            ):
+                improver(improver), pool(pool), skeleton_id(skeleton_id),
+                skeleton(improver.skeleton_store[skeleton_id]), place_table(this->skeleton),
+                placement(placement), cancellation(cancellation) {}
         public:
             void search();
         private:
@@ -50,15 +58,17 @@ namespace InsertionFinder {
     private:
         const Options options;
         std::mutex fewest_moves_mutex;
-        std::unordered_set<Algorithm> partial_solution_list;
-        std::unordered_map<Algorithm, SolvingStep> partial_solution_map;
+        SkeletonStore skeleton_store;
+        std::unordered_set<SkeletonStore::Id, SkeletonStore::Hash> partial_solution_list;
+        std::unordered_map<SkeletonStore::Id, SolvingStep> partial_solution_map;
         std::mutex worker_mutex;
     public:
         template<class Skeleton> SliceImprover(Skeleton&& skeleton, const std::vector<Case>& cases, Options options):
-            Improver(std::forward<Skeleton>(skeleton), cases), options(options) {}
+            Improver(std::forward<Skeleton>(skeleton), cases), options(options),
+            partial_solution_list(0, SkeletonStore::Hash {&this->skeleton_store}) {}
     protected:
         void search_core(const SearchParams& params) override;
     private:
-        void run_worker(boost::asio::thread_pool& pool, Algorithm&& skeleton, const SolvingStep& step);
+        void run_worker(boost::asio::thread_pool& pool, SkeletonStore::Id skeleton, const SolvingStep& step);
     };
 };
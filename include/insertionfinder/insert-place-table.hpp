@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <insertionfinder/algorithm.hpp>
+
+namespace InsertionFinder {
+    // Per-skeleton features of every insert place, built once so that workers can index them.
+    // The swapped view is the skeleton with one adjacent pair swapped, moved from place to place on demand.
+    class InsertPlaceTable {
+    private:
+        struct Place {
+            std::pair<std::uint32_t, std::uint32_t> mask;
+            std::pair<std::uint32_t, std::uint32_t> swapped_mask;
+            bool swappable;
+        };
+        const Algorithm& skeleton;
+        std::vector<Place> places;
+        Algorithm swapped_skeleton;
+        std::size_t swapped_place = 0;
+    public:
+        explicit InsertPlaceTable(const Algorithm& skeleton);
+        InsertPlaceTable(const InsertPlaceTable&) = delete;
+        InsertPlaceTable& operator=(const InsertPlaceTable&) = delete;
+    public:
+        bool swappable(std::size_t insert_place) const noexcept {
+            return this->places[insert_place].swappable;
+        }
+        std::pair<std::uint32_t, std::uint32_t> mask(std::size_t insert_place, bool swapped) const noexcept {
+            const Place& place = this->places[insert_place];
+            return swapped ? place.swapped_mask : place.mask;
+        }
+        const Algorithm& view(std::size_t insert_place, bool swapped) noexcept {
+            if (!swapped) {
+                return this->skeleton;
+            }
+            if (this->swapped_place != insert_place) {
+                if (this->swapped_place) {
+                    this->swapped_skeleton.swap_adjacent(this->swapped_place);
+                }
+                this->swapped_skeleton.swap_adjacent(insert_place);
+                this->swapped_place = insert_place;
+            }
+            return this->swapped_skeleton;
+        }
+    };
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <insertionfinder/algorithm.hpp>
+#include <insertionfinder/twist.hpp>
+
+namespace InsertionFinder {
+    // Interns skeletons into block-allocated storage and gives each distinct one a stable 32-bit id.
+    // Insertions are serialized internally, and an id may be read from any thread once it has been handed out.
+    // A skeleton derived from an interned parent only stores the twists between the prefix it shares with
+    // the parent and the suffix it shares with the rotated parent.
+    class SkeletonStore {
+    public:
+        using Id = std::uint32_t;
+        static constexpr Id none = -1;
+        struct Hash {
+            const SkeletonStore* store;
+            std::size_t operator()(Id id) const noexcept {
+                return this->store->hash(id);
+            }
+        };
+    private:
+        struct Entry {
+            const Twist* twists;
+            std::size_t hash;
+            std::uint32_t length;
+            Id parent;
+            std::uint32_t prefix_length;
+            std::uint32_t suffix_length;
+            std::uint8_t rotation;
+            std::uint8_t suffix_rotation;
+            std::uint8_t depth;
+            bool cancelled;
+        };
+        static constexpr std::size_t entry_block_bits = 16;
+        static constexpr std::size_t entry_block_size = std::size_t(1) << entry_block_bits;
+        static constexpr std::size_t twist_block_size = std::size_t(1) << 16;
+        static constexpr std::size_t max_depth = 8;
+        static constexpr std::size_t min_shared_length = 16;
+        // Entry blocks are added one at a time as ids run out. Readers skip the mutex, so they look blocks up
+        // through entry_table, a copy of the block pointers that is replaced by one twice its size when full.
+        // Replaced tables stay alive until the store is destroyed, as a reader may still hold one.
+        std::vector<std::unique_ptr<Entry[]>> entry_blocks;
+        std::vector<std::unique_ptr<Entry*[]>> entry_tables;
+        std::atomic<Entry* const*> entry_table {nullptr};
+        std::vector<std::unique_ptr<Twist[]>> twist_blocks;
+        Twist* twist_cursor = nullptr;
+        std::size_t twists_available = 0;
+        std::size_t count = 0;
+        std::vector<Id> table;
+        std::mutex mutex;
+    public:
+        SkeletonStore();
+        SkeletonStore(const SkeletonStore&) = delete;
+        SkeletonStore& operator=(const SkeletonStore&) = delete;
+        ~SkeletonStore() = default;
+    public:
+        std::pair<Id, bool> insert(const Algorithm& algorithm) {
+            return this->insert(algorithm, SkeletonStore::none, Algorithm(), 0);
+        }
+        std::pair<Id, bool> insert(
+            const Algorithm& algorithm,
+            Id parent_id, const Algorithm& parent, Rotation rotation
+        );
+        Algorithm operator[](Id id) const;
+        std::size_t length(Id id) const noexcept {
+            return this->entry(id).length;
+        }
+        std::size_t hash(Id id) const noexcept {
+            return this->entry(id).hash;
+        }
+        int compare(Id lhs, Id rhs) const;
+    private:
+        const Entry& entry(Id id) const noexcept {
+            Entry* const* table = this->entry_table.load(std::memory_order_acquire);
+            return table[id >> entry_block_bits][id & (entry_block_size - 1)];
+        }
+        void materialize(Id id, Algorithm& algorithm) const;
+        bool equals(Id id, const Algorithm& algorithm, std::size_t hash) const;
+        // Compare twists of stored skeletons, each divided by its rotation, walking the shared prefix
+        // and suffix in the parents instead of materializing the skeletons.
+        int compare_twists(
+            Id id, std::size_t begin, std::size_t end, Rotation rotation,
+            const Twist* twists, Rotation twists_rotation
+        ) const;
+        int compare_twists(
+            Id x, std::size_t x_begin, Rotation x_rotation,
+            Id y, std::size_t y_begin, Rotation y_rotation, std::size_t count
+        ) const;
+        void add_entry_block();
+        const Twist* store_twists(const Twist* begin, const Twist* end);
+        void grow_table();
+    };
+};
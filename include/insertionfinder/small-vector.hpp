@@ -0,0 +1,213 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace InsertionFinder::Details {
+    // A vector of trivially copyable elements whose first N elements are stored inline,
+    // so that short sequences never touch the heap.
+    template<class T, std::size_t N> class SmallVector {
+        static_assert(std::is_trivially_copyable_v<T>);
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    private:
+        T* storage;
+        std::uint32_t count;
+        std::uint32_t capacity_;
+        T buffer[N];
+    public:
+        SmallVector() noexcept: storage(this->buffer), count(0), capacity_(N) {}
+        SmallVector(const SmallVector& other): SmallVector() {
+            this->assign(other.begin(), other.end());
+        }
+        SmallVector(SmallVector&& other) noexcept: SmallVector() {
+            this->steal(other);
+        }
+        SmallVector& operator=(const SmallVector& other) {
+            if (this != &other) {
+                this->assign(other.begin(), other.end());
+            }
+            return *this;
+        }
+        SmallVector& operator=(SmallVector&& other) noexcept {
+            if (this != &other) {
+                this->release();
+                this->steal(other);
+            }
+            return *this;
+        }
+        ~SmallVector() {
+            this->release();
+        }
+    public:
+        size_type size() const noexcept {
+            return this->count;
+        }
+        size_type capacity() const noexcept {
+            return this->capacity_;
+        }
+        bool empty() const noexcept {
+            return this->count == 0;
+        }
+        bool is_inline() const noexcept {
+            return this->storage == this->buffer;
+        }
+        T* data() noexcept {
+            return this->storage;
+        }
+        const T* data() const noexcept {
+            return this->storage;
+        }
+        T& operator[](size_type index) noexcept {
+            return this->storage[index];
+        }
+        const T& operator[](size_type index) const noexcept {
+            return this->storage[index];
+        }
+        T& front() noexcept {
+            return this->storage[0];
+        }
+        const T& front() const noexcept {
+            return this->storage[0];
+        }
+        T& back() noexcept {
+            return this->storage[this->count - 1];
+        }
+        const T& back() const noexcept {
+            return this->storage[this->count - 1];
+        }
+    public:
+        iterator begin() noexcept {
+            return this->storage;
+        }
+        const_iterator begin() const noexcept {
+            return this->storage;
+        }
+        const_iterator cbegin() const noexcept {
+            return this->storage;
+        }
+        iterator end() noexcept {
+            return this->storage + this->count;
+        }
+        const_iterator end() const noexcept {
+            return this->storage + this->count;
+        }
+        const_iterator cend() const noexcept {
+            return this->storage + this->count;
+        }
+        reverse_iterator rbegin() noexcept {
+            return reverse_iterator(this->end());
+        }
+        const_reverse_iterator rbegin() const noexcept {
+            return const_reverse_iterator(this->end());
+        }
+        const_reverse_iterator crbegin() const noexcept {
+            return const_reverse_iterator(this->end());
+        }
+        reverse_iterator rend() noexcept {
+            return reverse_iterator(this->begin());
+        }
+        const_reverse_iterator rend() const noexcept {
+            return const_reverse_iterator(this->begin());
+        }
+        const_reverse_iterator crend() const noexcept {
+            return const_reverse_iterator(this->begin());
+        }
+    public:
+        void reserve(size_type capacity) {
+            if (capacity > this->capacity_) {
+                this->grow(capacity);
+            }
+        }
+        void clear() noexcept {
+            this->count = 0;
+        }
+        void resize(size_type size) {
+            this->reserve(size);
+            if (size > this->count) {
+                std::fill(this->storage + this->count, this->storage + size, T());
+            }
+            this->count = size;
+        }
+        void push_back(T value) {
+            if (this->count == this->capacity_) {
+                this->grow(this->capacity_ << 1);
+            }
+            this->storage[this->count++] = value;
+        }
+        template<class Iterator> void assign(Iterator first, Iterator last) {
+            this->count = 0;
+            this->append(first, last);
+        }
+        template<class Iterator> iterator insert(const_iterator position, Iterator first, Iterator last) {
+            if constexpr (std::is_convertible_v<Iterator, const T*>) {
+                // the range may live in this vector, which the move below would overwrite
+                const T* pointer = first;
+                std::less<const T*> less;
+                if (!less(pointer, this->storage) && less(pointer, this->storage + this->count)) {
+                    SmallVector copy;
+                    copy.assign(first, last);
+                    return this->insert(position, copy.cbegin(), copy.cend());
+                }
+            }
+            size_type offset = position - this->storage;
+            size_type size = std::distance(first, last);
+            this->reserve(this->count + size);
+            T* target = this->storage + offset;
+            std::memmove(target + size, target, (this->count - offset) * sizeof(T));
+            std::copy(first, last, target);
+            this->count += size;
+            return target;
+        }
+    public:
+        bool operator==(const SmallVector& rhs) const noexcept {
+            return this->count == rhs.count && std::equal(this->begin(), this->end(), rhs.begin());
+        }
+        bool operator!=(const SmallVector& rhs) const noexcept {
+            return !(*this == rhs);
+        }
+    private:
+        template<class Iterator> void append(Iterator first, Iterator last) {
+            this->reserve(this->count + std::distance(first, last));
+            this->count = std::copy(first, last, this->storage + this->count) - this->storage;
+        }
+        void grow(size_type capacity) {
+            capacity = std::max<size_type>(capacity, this->capacity_ << 1);
+            std::unique_ptr<T[]> storage(new T[capacity]);
+            std::memcpy(storage.get(), this->storage, this->count * sizeof(T));
+            this->release();
+            this->storage = storage.release();
+            this->capacity_ = capacity;
+        }
+        void release() noexcept {
+            if (!this->is_inline()) {
+                delete[] this->storage;
+            }
+            this->storage = this->buffer;
+            this->capacity_ = N;
+        }
+        void steal(SmallVector& other) noexcept {
+            if (other.is_inline()) {
+                std::memcpy(this->buffer, other.buffer, other.count * sizeof(T));
+            } else {
+                this->storage = other.storage;
+                this->capacity_ = other.capacity_;
+                other.storage = other.buffer;
+                other.capacity_ = N;
+            }
+            this->count = other.count;
+            other.count = 0;
+        }
+    };
+};
@@ -30,7 +30,7 @@ namespace InsertionFinder {
             {2, 1, 4}, {4, 1, 3}, {3, 1, 5}, {5, 1, 2},
             {3, 0, 4}, {5, 0, 3}, {2, 0, 5}, {4, 0, 2}
         };
-        static const std::array<std::array<int, 24>, 24> rotation_transform;
+        static const std::array<std::array<std::uint8_t, 24>, 24> rotation_transform;
     private:
         int rotation;
     public:
@@ -46,7 +46,7 @@ namespace InsertionFinder {
         friend std::ostream& ::operator<<(std::ostream& out, Rotation rotation);
         std::string str() const;
     private:
-        static std::array<std::array<int, 24>, 24> generate_rotation_transform_table() noexcept;
+        static constexpr std::array<std::array<std::uint8_t, 24>, 24> generate_rotation_transform_table() noexcept;
     public:
         constexpr Rotation inverse() const noexcept {
             return Rotation::inverse_rotation[this->rotation];
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <type_traits>
 #include <utility>
@@ -12,4 +14,58 @@ namespace InsertionFinder::Details {
     >>: std::true_type {};
 
     template <class T> constexpr bool is_iterable_v = is_iterable<T>::value;
+
+    // Multiply-xorshift mixer that spreads the bits of a hash into the low bits used as a table slot.
+    constexpr std::uint64_t mix_hash(std::uint64_t hash) noexcept {
+        hash ^= hash >> 32;
+        hash *= 0x9e3779b97f4a7c15;
+        return hash ^ hash >> 29;
+    }
+
+    // Iterates the indices of the set bits of a bitmap stored as 64-bit words, in increasing order.
+    class BitmapIndices {
+    private:
+        const std::uint64_t* words;
+        std::size_t size;
+    public:
+        class iterator {
+        private:
+            const std::uint64_t* words;
+            std::size_t size;
+            std::size_t word_index;
+            std::uint64_t word;
+        public:
+            iterator(const std::uint64_t* words, std::size_t size, std::size_t word_index):
+                words(words), size(size), word_index(word_index), word(word_index < size ? words[word_index] : 0) {
+                this->skip_empty_words();
+            }
+            std::size_t operator*() const noexcept {
+                return this->word_index << 6 | __builtin_ctzll(this->word);
+            }
+            iterator& operator++() noexcept {
+                this->word &= this->word - 1;
+                this->skip_empty_words();
+                return *this;
+            }
+            bool operator!=(const iterator& rhs) const noexcept {
+                return this->word_index != rhs.word_index || this->word != rhs.word;
+            }
+        private:
+            void skip_empty_words() noexcept {
+                while (this->word == 0 && this->word_index < this->size) {
+                    if (++this->word_index < this->size) {
+                        this->word = this->words[this->word_index];
+                    }
+                }
+            }
+        };
+    public:
+        template <class T> explicit BitmapIndices(const T& bitmap): words(bitmap.data()), size(bitmap.size()) {}
+        iterator begin() const noexcept {
+            return iterator(this->words, this->size, 0);
+        }
+        iterator end() const noexcept {
+            return iterator(this->words, this->size, this->size);
+        }
+    };
 };
@@ -39,6 +39,7 @@ std::vector<Algorithm> Algorithm::generate_symmetrics() const {
         }
     }
     for (Algorithm& algorithm: result) {
+        algorithm.rehash();
         algorithm.normalize();
         algorithm.detect_rotation();
     }
@@ -95,6 +96,7 @@ std::vector<Algorithm> Algorithm::generate_rotation_conjugates() const {
             Algorithm algorithm = base;
             algorithm.twists.front() = base.twists.back() * base.rotation;
             algorithm.twists.back() = base.twists.front() * base.rotation.inverse();
+            algorithm.rehash();
             result.push_back(std::move(algorithm));
         } else {
             uint_fast8_t twist_base = (base.twists.front() >> 3) << 3;
@@ -140,6 +142,7 @@ std::vector<Algorithm> Algorithm::generate_rotation_conjugates() const {
                                 Twist(twist_base | 4 | (sum[1] - j & 3)) / base.rotation
                             );
                         }
+                        algorithm.rehash();
                         result.push_back(std::move(algorithm));
                     }
                 }
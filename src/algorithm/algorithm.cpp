@@ -5,9 +5,7 @@
 #include <array>
 #include <functional>
 #include <istream>
-#include <iterator>
 #include <ostream>
-#include <regex>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -25,53 +23,98 @@ using InsertionFinder::AlgorithmError;
 using InsertionFinder::AlgorithmStreamError;
 using InsertionFinder::Cube;
 using InsertionFinder::InsertionAlgorithm;
+using InsertionFinder::InsertionMaskList;
 using InsertionFinder::Rotation;
 using InsertionFinder::Twist;
 namespace Details = InsertionFinder::Details;
 
 
 namespace {
-    struct Pattern {
-        const char* pattern_string;
-        Rotation rotation;
-    };
+    constexpr bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    constexpr int face_offset(char c) {
+        switch (c) {
+        case 'U':
+            return 0;
+        case 'D':
+            return 4;
+        case 'R':
+            return 8;
+        case 'L':
+            return 12;
+        case 'F':
+            return 16;
+        case 'B':
+            return 20;
+        default:
+            return -1;
+        }
+    }
 
-    constexpr Pattern pattern_table[9] = {
-        {"x", 12}, {"x2", 8}, {"x'", 4},
-        {"y", 3}, {"y2", 2}, {"y'", 1},
-        {"z", 20}, {"z2", 10}, {"z'", 16}
+    constexpr int rotation_axis(char c) {
+        switch (c) {
+        case 'x':
+            return 0;
+        case 'y':
+            return 1;
+        case 'z':
+            return 2;
+        default:
+            return -1;
+        }
+    }
+
+    constexpr Rotation rotation_table[3][3] = {
+        {12, 8, 4},
+        {3, 2, 1},
+        {20, 10, 16}
     };
+
+    constexpr std::array<size_t, 256> fingerprint_power_table = []() {
+        std::array<size_t, 256> table {};
+        table[0] = 1;
+        for (size_t i = 1; i < table.size(); ++i) {
+            table[i] = table[i - 1] * 31;
+        }
+        return table;
+    }();
 };
 
 
-Algorithm::Algorithm(const char* algorithm_string) {
-    static const std::regex twists_regex(
-        R"(\s*([UDRLFBxyz][2']?)\s*)",
-        std::regex_constants::ECMAScript | std::regex_constants::optimize
-    );
+Algorithm::Algorithm(const char* algorithm_string): fingerprint(0) {
     Rotation rotation = 0;
-    std::cmatch match_result;
-    const char* string_view = algorithm_string;
-    while (std::regex_search(string_view, match_result, twists_regex)) {
-        if (match_result.position()) {
-            throw AlgorithmError(algorithm_string);
+    const char* p = algorithm_string;
+    if (*p) {
+        while (is_space(*p)) {
+            ++p;
         }
-        const std::string match_string = match_result.str(1);
-        if (
-            auto pattern = std::find_if(
-                std::begin(pattern_table), std::end(pattern_table),
-                [&](const Pattern& pattern) {return pattern.pattern_string == match_string;}
-            );
-            pattern == pattern_table + std::size(pattern_table)
-        ) {
-            this->twists.push_back(Twist(match_string) * rotation);
-        } else {
-            rotation = pattern->rotation * rotation;
-        }
-        string_view += match_result.length();
-    }
-    if (*string_view) {
-        throw AlgorithmError(algorithm_string);
+        do {
+            int face = face_offset(*p);
+            int axis = rotation_axis(*p);
+            if (face < 0 && axis < 0) {
+                throw AlgorithmError(algorithm_string);
+            }
+            int amount = 1;
+            if (*++p == '2') {
+                amount = 2;
+                ++p;
+            } else if (*p == '\'') {
+                amount = 3;
+                ++p;
+            }
+            if (face >= 0) {
+                Twist twist = Twist(face + amount) * rotation;
+                this->twists.push_back(twist);
+                this->fingerprint = this->fingerprint * 31 + twist;
+            } else {
+                rotation = rotation_table[axis][amount - 1] * rotation;
+            }
+            while (is_space(*p)) {
+                ++p;
+            }
+        } while (*p);
     }
     this->rotation = rotation.inverse();
 }
@@ -171,6 +214,8 @@ void Algorithm::read_from(std::istream& in) {
         throw AlgorithmStreamError();
     }
     this->twists.assign(data.get(), data.get() + length);
+    this->rehash();
+    this->cancelled = false;
     char rotation_data;
     in.read(&rotation_data, 1);
     if (in.gcount() != 1) {
@@ -181,7 +226,16 @@ void Algorithm::read_from(std::istream& in) {
 
 void InsertionAlgorithm::read_from(std::istream& in) {
     this->Algorithm::read_from(in);
+    this->compute_masks();
+}
+
+void InsertionAlgorithm::compute_masks() noexcept {
     size_t length = this->length();
+    if (length == 0) {
+        this->begin_mask = this->end_mask = this->set_up_mask = 0;
+        this->cancelled = true;
+        return;
+    }
     this->begin_mask = Details::twist_mask(this->twists[0].inverse());
     if (length > 1 && this->twists[0] >> 3 == this->twists[1] >> 3) {
         this->begin_mask |= Details::twist_mask(this->twists[1].inverse());
@@ -202,6 +256,37 @@ void InsertionAlgorithm::read_from(std::istream& in) {
     } else {
         this->set_up_mask = 0;
     }
+    this->cancelled = true;
+    for (size_t i = 1; i < length; ++i) {
+        bool same_axis = this->twists[i - 1] >> 3 == this->twists[i] >> 3;
+        if (
+            this->twists[i - 1] >> 2 == this->twists[i] >> 2
+            || (same_axis && i > 1 && this->twists[i - 2] >> 3 == this->twists[i] >> 3)
+        ) {
+            this->cancelled = false;
+        }
+    }
+}
+
+void InsertionMaskList::push_back(const InsertionAlgorithm& algorithm) {
+    this->begin_masks.push_back(algorithm.begin_mask);
+    this->end_masks.push_back(algorithm.end_mask);
+    this->set_up_masks.push_back(algorithm.set_up_mask);
+    this->lengths.push_back(algorithm.length());
+}
+
+void InsertionMaskList::assign(const std::vector<InsertionAlgorithm>& algorithms) {
+    this->begin_masks.clear();
+    this->end_masks.clear();
+    this->set_up_masks.clear();
+    this->lengths.clear();
+    this->begin_masks.reserve(algorithms.size());
+    this->end_masks.reserve(algorithms.size());
+    this->set_up_masks.reserve(algorithms.size());
+    this->lengths.reserve(algorithms.size());
+    for (const InsertionAlgorithm& algorithm: algorithms) {
+        this->push_back(algorithm);
+    }
 }
 
 
@@ -209,8 +294,11 @@ Algorithm Algorithm::operator+(const Algorithm& rhs) const {
     Algorithm result;
     result.twists.reserve(this->length() + rhs.length());
     result.twists.assign(this->twists.cbegin(), this->twists.cend());
+    result.fingerprint = this->fingerprint;
     for (Twist twist: rhs.twists) {
-        result.twists.push_back(twist / this->rotation);
+        twist /= this->rotation;
+        result.twists.push_back(twist);
+        result.fingerprint = result.fingerprint * 31 + twist;
     }
     result.rotation = this->rotation * rhs.rotation;
     return result;
@@ -219,21 +307,40 @@ Algorithm Algorithm::operator+(const Algorithm& rhs) const {
 Algorithm& Algorithm::operator+=(const Algorithm& rhs) {
     this->twists.reserve(this->length() + rhs.length());
     for (Twist twist: rhs.twists) {
-        this->twists.push_back(twist / this->rotation);
+        twist /= this->rotation;
+        this->twists.push_back(twist);
+        this->fingerprint = this->fingerprint * 31 + twist;
     }
     this->rotation *= rhs.rotation;
+    this->cancelled = false;
     return *this;
 }
 
 
 size_t std::hash<Algorithm>::operator()(const Algorithm& algorithm) const noexcept {
-    size_t result = algorithm.rotation;
-    for (Twist twist: algorithm.twists) {
-        result = result * 31 + twist;
+    size_t rotation = algorithm.rotation;
+    return rotation * Algorithm::fingerprint_power(algorithm.length()) + algorithm.fingerprint;
+}
+
+size_t Algorithm::fingerprint_power(size_t exponent) noexcept {
+    if (exponent < fingerprint_power_table.size()) {
+        return fingerprint_power_table[exponent];
+    }
+    size_t result = fingerprint_power_table.back();
+    for (size_t i = fingerprint_power_table.size() - 1; i < exponent; ++i) {
+        result *= 31;
     }
     return result;
 }
 
+void Algorithm::rehash() noexcept {
+    size_t fingerprint = 0;
+    for (Twist twist: this->twists) {
+        fingerprint = fingerprint * 31 + twist;
+    }
+    this->fingerprint = fingerprint;
+}
+
 
 void Algorithm::detect_rotation() noexcept {
     Cube cube = Cube() * *this;
@@ -241,6 +348,14 @@ void Algorithm::detect_rotation() noexcept {
 }
 
 
+void Algorithm::swap_adjacent(size_t place) noexcept {
+    Twist& x = this->twists[place - 1];
+    Twist& y = this->twists[place];
+    size_t difference = static_cast<size_t>(y) - static_cast<size_t>(x);
+    this->fingerprint += difference * 30 * Algorithm::fingerprint_power(this->length() - 1 - place);
+    std::swap(x, y);
+}
+
 void Algorithm::normalize() noexcept {
     for (size_t i = 1, length = this->length(); i < length; ++i) {
         if (this->swappable(i) && this->twists[i - 1] > this->twists[i]) {
@@ -253,6 +368,7 @@ void Algorithm::rotate(Rotation rotation) {
     for (Twist& twist: this->twists) {
         twist *= rotation;
     }
+    this->rehash();
     this->rotation = rotation.inverse() * this->rotation * rotation;
 }
 
@@ -266,7 +382,9 @@ Algorithm Algorithm::inverse(const Algorithm& algorithm) {
     Algorithm result;
     result.twists.reserve(algorithm.length());
     for (auto iter = algorithm.twists.crbegin(); iter != algorithm.twists.crend(); ++iter) {
-        result.twists.push_back(*iter * algorithm.rotation);
+        Twist twist = *iter * algorithm.rotation;
+        result.twists.push_back(twist);
+        result.fingerprint = result.fingerprint * 31 + twist;
     }
     result.rotation = algorithm.rotation.inverse();
     return result;
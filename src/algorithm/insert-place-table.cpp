@@ -0,0 +1,23 @@
+#include <cstddef>
+#include <insertionfinder/algorithm.hpp>
+#include <insertionfinder/insert-place-table.hpp>
+using std::size_t;
+using InsertionFinder::Algorithm;
+using InsertionFinder::InsertPlaceTable;
+
+
+InsertPlaceTable::InsertPlaceTable(const Algorithm& skeleton):
+    skeleton(skeleton), places(skeleton.length() + 1), swapped_skeleton(skeleton) {
+    for (size_t insert_place = 0; insert_place <= skeleton.length(); ++insert_place) {
+        Place& place = this->places[insert_place];
+        place.mask = skeleton.get_insert_place_mask(insert_place);
+        place.swappable = skeleton.swappable(insert_place);
+        if (place.swappable) {
+            this->swapped_skeleton.swap_adjacent(insert_place);
+            place.swapped_mask = this->swapped_skeleton.get_insert_place_mask(insert_place);
+            this->swapped_skeleton.swap_adjacent(insert_place);
+        } else {
+            place.swapped_mask = place.mask;
+        }
+    }
+}
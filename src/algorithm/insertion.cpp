@@ -9,20 +9,172 @@
 #include <insertionfinder/algorithm.hpp>
 #include <insertionfinder/cube.hpp>
 #include "utils.hpp"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INSERTIONFINDER_X86_KERNELS
+#include <immintrin.h>
+#endif
+using std::int32_t;
 using std::size_t;
 using std::uint32_t;
+using std::uint64_t;
 using std::uint_fast8_t;
 using InsertionFinder::Algorithm;
 using InsertionFinder::InsertionAlgorithm;
+using InsertionFinder::InsertionBitmap;
+using InsertionFinder::InsertionMaskList;
+using InsertionFinder::Twist;
 namespace Details = InsertionFinder::Details;
 
 
+namespace {
+    inline bool is_worthy(
+        uint32_t insertion_begin_mask, uint32_t insertion_end_mask, uint32_t insertion_set_up_mask,
+        size_t insertion_length, size_t skeleton_length, size_t insert_place,
+        std::pair<uint32_t, uint32_t> insert_place_mask, size_t fewest_twists
+    ) noexcept {
+        size_t cancellation = 0;
+        if (uint32_t begin_mask = insert_place_mask.first & insertion_begin_mask) {
+            if (begin_mask & (insertion_set_up_mask | 0xffffff)) {
+                return false;
+            }
+            uint32_t high_mask = begin_mask >> 24;
+            cancellation += high_mask & (high_mask - 1) ? 2 : 1;
+        }
+        if (uint32_t end_mask = insert_place_mask.second & insertion_end_mask) {
+            if (end_mask & insertion_set_up_mask & 0xffffff) {
+                return false;
+            }
+            uint32_t low_mask = end_mask & 0xffffff;
+            uint32_t high_mask = end_mask >> 24;
+            if (high_mask & (high_mask - 1)) {
+                if (low_mask == 0) {
+                    cancellation += 2;
+                } else if (low_mask & (low_mask - 1)) {
+                    cancellation += (skeleton_length - insert_place) << 1;
+                } else {
+                    cancellation += 3;
+                }
+            } else if (low_mask) {
+                cancellation += (skeleton_length - insert_place) << 1;
+            } else {
+                ++cancellation;
+            }
+        }
+        return fewest_twists == std::numeric_limits<size_t>::max()
+            || skeleton_length + insertion_length <= fewest_twists + cancellation;
+    }
+
+    // Kernels fill the bitmap for a prefix of the list and return its size. The budget is the fewest twists minus
+    // the skeleton length, and an insertion is worthy if its length minus its cancellation does not exceed it.
+    using WorthyKernel = size_t (*)(
+        const uint32_t* begin_masks, const uint32_t* end_masks, const uint32_t* set_up_masks,
+        const uint32_t* lengths, size_t size,
+        uint32_t mask_before, uint32_t mask_after, int32_t tail_cancellation, int32_t budget,
+        uint64_t* bitmap
+    );
+
+    constexpr size_t max_budget = std::size_t(1) << 24;
+
+    size_t worthy_none(
+        const uint32_t*, const uint32_t*, const uint32_t*, const uint32_t*, size_t,
+        uint32_t, uint32_t, int32_t, int32_t, uint64_t*
+    ) {
+        return 0;
+    }
+
+#ifdef INSERTIONFINDER_X86_KERNELS
+    __attribute__((target("avx2")))
+    inline __m256i nonzero_avx2(__m256i x) {
+        return _mm256_xor_si256(_mm256_cmpeq_epi32(x, _mm256_setzero_si256()), _mm256_set1_epi32(-1));
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i more_than_one_bit_avx2(__m256i x) {
+        return nonzero_avx2(_mm256_and_si256(x, _mm256_sub_epi32(x, _mm256_set1_epi32(1))));
+    }
+
+    __attribute__((target("avx2")))
+    size_t worthy_avx2(
+        const uint32_t* begin_masks, const uint32_t* end_masks, const uint32_t* set_up_masks,
+        const uint32_t* lengths, size_t size,
+        uint32_t mask_before, uint32_t mask_after, int32_t tail_cancellation, int32_t budget,
+        uint64_t* bitmap
+    ) {
+        const __m256i before = _mm256_set1_epi32(mask_before);
+        const __m256i after = _mm256_set1_epi32(mask_after);
+        const __m256i low = _mm256_set1_epi32(0xffffff);
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i two = _mm256_set1_epi32(2);
+        const __m256i three = _mm256_set1_epi32(3);
+        const __m256i tail = _mm256_set1_epi32(tail_cancellation);
+        const __m256i limit = _mm256_set1_epi32(budget);
+        size_t index = 0;
+        for (; index + 8 <= size; index += 8) {
+            __m256i set_up_mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(set_up_masks + index));
+            __m256i begin_mask = _mm256_and_si256(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin_masks + index)), before
+            );
+            __m256i end_mask = _mm256_and_si256(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(end_masks + index)), after
+            );
+            __m256i rejected = _mm256_or_si256(
+                nonzero_avx2(_mm256_and_si256(begin_mask, _mm256_or_si256(set_up_mask, low))),
+                nonzero_avx2(_mm256_and_si256(end_mask, _mm256_and_si256(set_up_mask, low)))
+            );
+
+            __m256i begin_high = _mm256_srli_epi32(begin_mask, 24);
+            __m256i cancellation = _mm256_sub_epi32(
+                _mm256_setzero_si256(),
+                _mm256_add_epi32(nonzero_avx2(begin_mask), more_than_one_bit_avx2(begin_high))
+            );
+
+            __m256i end_low = _mm256_and_si256(end_mask, low);
+            __m256i end_high = _mm256_srli_epi32(end_mask, 24);
+            __m256i low_nonzero = nonzero_avx2(end_low);
+            __m256i one_face = _mm256_blendv_epi8(one, tail, low_nonzero);
+            __m256i two_faces = _mm256_blendv_epi8(
+                two, _mm256_blendv_epi8(three, tail, more_than_one_bit_avx2(end_low)), low_nonzero
+            );
+            __m256i end_cancellation = _mm256_and_si256(
+                _mm256_blendv_epi8(one_face, two_faces, more_than_one_bit_avx2(end_high)),
+                nonzero_avx2(end_mask)
+            );
+            cancellation = _mm256_add_epi32(cancellation, end_cancellation);
+
+            __m256i length = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lengths + index));
+            __m256i too_long = _mm256_cmpgt_epi32(_mm256_sub_epi32(length, cancellation), limit);
+            uint64_t worthy = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(rejected, too_long))) & 0xff;
+            bitmap[index >> 6] |= worthy << (index & 63);
+        }
+        return index;
+    }
+#endif
+
+    WorthyKernel select_worthy_kernel() noexcept {
+#ifdef INSERTIONFINDER_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return worthy_avx2;
+        }
+#endif
+        return worthy_none;
+    }
+
+    const WorthyKernel worthy_kernel = select_worthy_kernel();
+};
+
+
 size_t Algorithm::cancel_moves() noexcept {
+    return this->cancel_moves(0, this->length());
+}
+
+size_t Algorithm::cancel_moves(size_t begin_index, size_t end_index) noexcept {
     auto begin = this->twists.begin();
-    auto end = this->twists.cend();
-    auto p = begin - 1;
+    auto end = this->twists.end();
+    auto p = begin + begin_index - 1;
     auto needle = end;
-    for (auto q = begin; q != end; ++q) {
+    auto clean = begin + std::min(end_index + 1, this->length());
+    for (auto q = begin + begin_index; q != end; ++q) {
         if (p < begin || *p >> 3 != *q >> 3) {
             *++p = *q;
         } else if (*p >> 2 != *q >> 2) {
@@ -49,8 +201,15 @@ size_t Algorithm::cancel_moves() noexcept {
                 needle = p + 1;
             }
         }
+        if (q >= clean && *p == *q && (p == begin || *(p - 1) == *(q - 1))) {
+            // the stack ends with two untouched moves of the cancelled tail, so the rest of the tail stays as is
+            p = std::copy(q + 1, end, p + 1) - 1;
+            break;
+        }
     }
     this->twists.resize(p + 1 - begin);
+    this->rehash();
+    this->cancelled = true;
     return needle - begin;
 }
 
@@ -87,6 +246,8 @@ std::vector<int> Algorithm::cancel_moves_return_marks() {
         }
     }
     this->twists.resize(y + 1);
+    this->rehash();
+    this->cancelled = true;
     std::vector<int> marks(length, 2);
     for (const auto& list: stacks) {
         if (list.size() == 1) {
@@ -123,8 +284,8 @@ std::pair<uint32_t, uint32_t> Algorithm::get_insert_place_mask(size_t insert_pla
 }
 
 
-std::pair<Algorithm, size_t> Algorithm::insert(const Algorithm& insertion, size_t insert_place) const {
-    Algorithm result;
+size_t Algorithm::insert_into(Algorithm& result, const Algorithm& insertion, size_t insert_place) const {
+    result.rotation = 0;
     result.twists.reserve(this->length() + insertion.length());
     result.twists.assign(this->twists.cbegin(), this->twists.cbegin() + insert_place);
     result.twists.insert(result.twists.cend(), insertion.twists.cbegin(), insertion.twists.cend());
@@ -135,8 +296,89 @@ std::pair<Algorithm, size_t> Algorithm::insert(const Algorithm& insertion, size_
             result.twists.push_back(this->twists[index] / insertion.rotation);
         }
     }
-    size_t place = result.cancel_moves();
-    return {result, std::min(place, insert_place + 1)};
+    size_t place = this->cancelled
+        ? result.cancel_moves(insert_place, insert_place + insertion.length())
+        : result.cancel_moves();
+    return std::min(place, insert_place + 1);
+}
+
+std::pair<Algorithm, size_t> Algorithm::insert(const Algorithm& insertion, size_t insert_place) const {
+    std::pair<Algorithm, size_t> result;
+    result.second = this->insert_into(result.first, insertion, insert_place);
+    return result;
+}
+
+size_t Algorithm::insert_length(const Algorithm& insertion, size_t insert_place) const {
+    if (!this->cancelled) {
+        Algorithm result;
+        this->insert_into(result, insertion, insert_place);
+        return result.length();
+    }
+    // Runs the cancellation of insert_into on a stack that only holds the moves above the untouched part
+    // of the skeleton, which is read in place instead of being copied.
+    Details::SmallVector<Twist, Algorithm::inline_capacity> stack;
+    size_t base = insert_place;
+    size_t length = this->length();
+    size_t total = insertion.length() + length - insert_place;
+    for (size_t index = 0; index < total; ++index) {
+        bool from_skeleton = index >= insertion.length();
+        size_t skeleton_index = index - insertion.length() + insert_place;
+        Twist twist = from_skeleton
+            ? this->twists[skeleton_index] / insertion.rotation
+            : insertion.twists[index];
+        while (stack.size() < 2 && base > 0) {
+            Twist below = this->twists[--base];
+            stack.insert(stack.cbegin(), &below, &below + 1);
+        }
+        size_t size = stack.size();
+        if (size == 0 || stack[size - 1] >> 3 != twist >> 3) {
+            stack.push_back(twist);
+        } else if (stack[size - 1] >> 2 != twist >> 2) {
+            if (size > 1 && stack[size - 2] >> 3 == stack[size - 1] >> 3) {
+                if (uint_fast8_t orientation = (stack[size - 2] + twist) & 3; orientation == 0) {
+                    stack[size - 2] = stack[size - 1];
+                    stack.resize(size - 1);
+                } else {
+                    stack[size - 2] = (stack[size - 2] & ~3) | orientation;
+                }
+            } else {
+                stack.push_back(twist);
+            }
+        } else {
+            if (uint_fast8_t orientation = (stack[size - 1] + twist) & 3; orientation == 0) {
+                stack.resize(size - 1);
+            } else {
+                stack[size - 1] = (stack[size - 1] & ~3) | orientation;
+            }
+        }
+        size = stack.size();
+        if (
+            from_skeleton && skeleton_index > insert_place
+            && size > 0 && stack[size - 1] == twist
+            && (
+                size > 1
+                ? stack[size - 2] == this->twists[skeleton_index - 1] / insertion.rotation
+                : base == 0
+            )
+        ) {
+            return base + size + length - skeleton_index - 1;
+        }
+    }
+    return base + stack.size();
+}
+
+size_t Algorithm::insert_length(
+    const InsertionAlgorithm& insertion, size_t insert_place,
+    std::pair<uint32_t, uint32_t> insert_place_mask
+) const {
+    if (
+        this->cancelled && insertion.cancelled && insertion.length() > 1
+        && !(insert_place_mask.first & insertion.begin_mask)
+        && !(insert_place_mask.second & insertion.end_mask)
+    ) {
+        return this->length() + insertion.length();
+    }
+    return this->insert_length(insertion, insert_place);
 }
 
 std::tuple<Algorithm, std::vector<int>, std::vector<int>>
@@ -212,34 +454,40 @@ bool Algorithm::is_worthy_insertion(
     std::pair<uint32_t, uint32_t> insert_place_mask,
     size_t fewest_twists
 ) const {
-    size_t cancellation = 0;
-    if (uint32_t begin_mask = insert_place_mask.first & insertion.begin_mask) {
-        if (begin_mask & (insertion.set_up_mask | 0xffffff)) {
-            return false;
-        }
-        uint32_t high_mask = begin_mask >> 24;
-        cancellation += high_mask & (high_mask - 1) ? 2 : 1;
-    }
-    if (uint32_t end_mask = insert_place_mask.second & insertion.end_mask) {
-        if (end_mask & insertion.set_up_mask & 0xffffff) {
-            return false;
-        }
-        uint32_t low_mask = end_mask & 0xffffff;
-        uint32_t high_mask = end_mask >> 24;
-        if (high_mask & (high_mask - 1)) {
-            if (low_mask == 0) {
-                cancellation += 2;
-            } else if (low_mask & (low_mask - 1)) {
-                cancellation += (this->length() - insert_place) << 1;
-            } else {
-                cancellation += 3;
-            }
-        } else if (low_mask) {
-            cancellation += (this->length() - insert_place) << 1;
-        } else {
-            ++cancellation;
+    return is_worthy(
+        insertion.begin_mask, insertion.end_mask, insertion.set_up_mask, insertion.length(),
+        this->length(), insert_place, insert_place_mask, fewest_twists
+    );
+}
+
+void Algorithm::find_worthy_insertions(
+    const InsertionMaskList& insertions, size_t insert_place,
+    std::pair<uint32_t, uint32_t> insert_place_mask,
+    size_t fewest_twists, InsertionBitmap& bitmap
+) const {
+    size_t size = insertions.size();
+    bitmap.clear();
+    bitmap.resize((size + 63) >> 6);
+    size_t length = this->length();
+    bool unlimited = fewest_twists == std::numeric_limits<size_t>::max();
+    size_t begin = 0;
+    if (length <= max_budget && (unlimited || fewest_twists <= max_budget)) {
+        int32_t budget = unlimited
+            ? std::numeric_limits<int32_t>::max()
+            : static_cast<int32_t>(fewest_twists) - static_cast<int32_t>(length);
+        begin = worthy_kernel(
+            insertions.begin_masks.data(), insertions.end_masks.data(),
+            insertions.set_up_masks.data(), insertions.lengths.data(), size,
+            insert_place_mask.first, insert_place_mask.second,
+            static_cast<int32_t>((length - insert_place) << 1), budget, bitmap.data()
+        );
+    }
+    for (size_t index = begin; index < size; ++index) {
+        if (is_worthy(
+            insertions.begin_masks[index], insertions.end_masks[index], insertions.set_up_masks[index],
+            insertions.lengths[index], length, insert_place, insert_place_mask, fewest_twists
+        )) {
+            bitmap[index >> 6] |= uint64_t(1) << (index & 63);
         }
     }
-    return fewest_twists == std::numeric_limits<size_t>::max()
-        || this->length() + insertion.length() <= fewest_twists + cancellation;
 }
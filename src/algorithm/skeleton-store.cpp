@@ -0,0 +1,285 @@
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <insertionfinder/algorithm.hpp>
+#include <insertionfinder/skeleton-store.hpp>
+#include <insertionfinder/twist.hpp>
+#include <insertionfinder/utils.hpp>
+using std::size_t;
+using InsertionFinder::Algorithm;
+using InsertionFinder::Rotation;
+using InsertionFinder::SkeletonStore;
+using InsertionFinder::Twist;
+namespace Details = InsertionFinder::Details;
+
+
+namespace {
+    int compare_twists(const Twist* x, Rotation x_rotation, const Twist* y, Rotation y_rotation, size_t count) {
+        if (x_rotation == 0 && y_rotation == 0) {
+            return std::memcmp(x, y, count * sizeof(Twist));
+        }
+        for (size_t index = 0; index < count; ++index) {
+            Twist twist_x = x[index] / x_rotation;
+            Twist twist_y = y[index] / y_rotation;
+            if (twist_x != twist_y) {
+                return twist_x < twist_y ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+};
+
+
+SkeletonStore::SkeletonStore(): table(1 << 10, SkeletonStore::none) {}
+
+
+std::pair<SkeletonStore::Id, bool> SkeletonStore::insert(
+    const Algorithm& algorithm, Id parent_id, const Algorithm& parent, Rotation rotation
+) {
+    size_t hash = std::hash<Algorithm>()(algorithm);
+    size_t length = algorithm.length();
+    size_t prefix_length = 0;
+    size_t suffix_length = 0;
+    if (parent_id != SkeletonStore::none) {
+        prefix_length = std::mismatch(
+            algorithm.twists.cbegin(), algorithm.twists.cend(),
+            parent.twists.cbegin(), parent.twists.cend()
+        ).first - algorithm.twists.cbegin();
+        size_t parent_length = parent.length();
+        while (
+            suffix_length < length - prefix_length && suffix_length < parent_length
+            && algorithm.twists[length - 1 - suffix_length]
+                == parent.twists[parent_length - 1 - suffix_length] / rotation
+        ) {
+            ++suffix_length;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    size_t mask = this->table.size() - 1;
+    size_t slot = Details::mix_hash(hash) & mask;
+    for (; this->table[slot] != SkeletonStore::none; slot = (slot + 1) & mask) {
+        if (this->equals(this->table[slot], algorithm, hash)) {
+            return {this->table[slot], false};
+        }
+    }
+    Id id = this->count;
+    if ((id & (entry_block_size - 1)) == 0) {
+        this->add_entry_block();
+    }
+    Entry& entry = this->entry_blocks.back()[id & (entry_block_size - 1)];
+    entry.hash = hash;
+    entry.length = length;
+    entry.rotation = algorithm.rotation;
+    entry.cancelled = algorithm.cancelled;
+    if (
+        parent_id != SkeletonStore::none && prefix_length + suffix_length >= min_shared_length
+        && static_cast<size_t>(this->entry(parent_id).depth) + 1 < max_depth
+    ) {
+        entry.twists = this->store_twists(
+            algorithm.twists.cbegin() + prefix_length,
+            algorithm.twists.cend() - suffix_length
+        );
+        entry.parent = parent_id;
+        entry.prefix_length = prefix_length;
+        entry.suffix_length = suffix_length;
+        entry.suffix_rotation = rotation;
+        entry.depth = this->entry(parent_id).depth + 1;
+    } else {
+        entry.twists = this->store_twists(algorithm.twists.cbegin(), algorithm.twists.cend());
+        entry.parent = SkeletonStore::none;
+        entry.prefix_length = 0;
+        entry.suffix_length = 0;
+        entry.suffix_rotation = 0;
+        entry.depth = 0;
+    }
+    this->table[slot] = id;
+    if (++this->count << 1 > this->table.size()) {
+        this->grow_table();
+    }
+    return {id, true};
+}
+
+Algorithm SkeletonStore::operator[](Id id) const {
+    Algorithm algorithm;
+    this->materialize(id, algorithm);
+    algorithm.rotation = this->entry(id).rotation;
+    algorithm.cancelled = this->entry(id).cancelled;
+    algorithm.rehash();
+    return algorithm;
+}
+
+int SkeletonStore::compare(Id lhs, Id rhs) const {
+    const Entry& x = this->entry(lhs);
+    const Entry& y = this->entry(rhs);
+    if (int result = static_cast<int>(x.length) - static_cast<int>(y.length)) {
+        return result;
+    }
+    if (lhs != rhs) {
+        if (int result = this->compare_twists(lhs, 0, 0, rhs, 0, 0, x.length)) {
+            return result;
+        }
+    }
+    return x.rotation - y.rotation;
+}
+
+
+void SkeletonStore::materialize(Id id, Algorithm& algorithm) const {
+    const Entry& entry = this->entry(id);
+    auto& twists = algorithm.twists;
+    if (entry.parent == SkeletonStore::none) {
+        twists.assign(entry.twists, entry.twists + entry.length);
+        return;
+    }
+    this->materialize(entry.parent, algorithm);
+    size_t parent_length = twists.size();
+    size_t suffix_begin = entry.length - entry.suffix_length;
+    twists.resize(std::max<size_t>(parent_length, entry.length));
+    Twist* data = twists.data();
+    std::memmove(
+        data + suffix_begin,
+        data + parent_length - entry.suffix_length,
+        entry.suffix_length * sizeof(Twist)
+    );
+    std::copy(entry.twists, entry.twists + suffix_begin - entry.prefix_length, data + entry.prefix_length);
+    Rotation rotation = entry.suffix_rotation;
+    for (size_t index = suffix_begin; index < entry.length; ++index) {
+        data[index] /= rotation;
+    }
+    twists.resize(entry.length);
+}
+
+bool SkeletonStore::equals(Id id, const Algorithm& algorithm, size_t hash) const {
+    const Entry& entry = this->entry(id);
+    if (entry.hash != hash || entry.length != algorithm.length() || entry.rotation != algorithm.rotation) {
+        return false;
+    }
+    return this->compare_twists(id, 0, entry.length, 0, algorithm.twists.data(), 0) == 0;
+}
+
+int SkeletonStore::compare_twists(
+    Id id, size_t begin, size_t end, Rotation rotation,
+    const Twist* twists, Rotation twists_rotation
+) const {
+    const Entry& entry = this->entry(id);
+    if (entry.parent == SkeletonStore::none) {
+        return ::compare_twists(entry.twists + begin, rotation, twists, twists_rotation, end - begin);
+    }
+    size_t suffix_begin = entry.length - entry.suffix_length;
+    size_t parent_suffix_begin = this->entry(entry.parent).length - entry.suffix_length;
+    for (size_t index = begin; index < end;) {
+        size_t next;
+        int result;
+        if (index < entry.prefix_length) {
+            next = std::min<size_t>(end, entry.prefix_length);
+            result = this->compare_twists(entry.parent, index, next, rotation, twists, twists_rotation);
+        } else if (index < suffix_begin) {
+            next = std::min(end, suffix_begin);
+            result = ::compare_twists(
+                entry.twists + (index - entry.prefix_length), rotation,
+                twists, twists_rotation, next - index
+            );
+        } else {
+            next = end;
+            result = this->compare_twists(
+                entry.parent, index - suffix_begin + parent_suffix_begin, end - suffix_begin + parent_suffix_begin,
+                rotation * Rotation(entry.suffix_rotation), twists, twists_rotation
+            );
+        }
+        if (result) {
+            return result;
+        }
+        twists += next - index;
+        index = next;
+    }
+    return 0;
+}
+
+int SkeletonStore::compare_twists(
+    Id x, size_t x_begin, Rotation x_rotation,
+    Id y, size_t y_begin, Rotation y_rotation, size_t count
+) const {
+    const Entry& entry = this->entry(y);
+    if (entry.parent == SkeletonStore::none) {
+        return this->compare_twists(x, x_begin, x_begin + count, x_rotation, entry.twists + y_begin, y_rotation);
+    }
+    size_t suffix_begin = entry.length - entry.suffix_length;
+    size_t parent_suffix_begin = this->entry(entry.parent).length - entry.suffix_length;
+    for (size_t index = y_begin, end = y_begin + count; index < end;) {
+        size_t next;
+        int result;
+        if (index < entry.prefix_length) {
+            next = std::min<size_t>(end, entry.prefix_length);
+            result = this->compare_twists(x, x_begin, x_rotation, entry.parent, index, y_rotation, next - index);
+        } else if (index < suffix_begin) {
+            next = std::min(end, suffix_begin);
+            result = this->compare_twists(
+                x, x_begin, x_begin + next - index, x_rotation,
+                entry.twists + (index - entry.prefix_length), y_rotation
+            );
+        } else {
+            next = end;
+            result = this->compare_twists(
+                x, x_begin, x_rotation,
+                entry.parent, index - suffix_begin + parent_suffix_begin,
+                y_rotation * Rotation(entry.suffix_rotation), next - index
+            );
+        }
+        if (result) {
+            return result;
+        }
+        x_begin += next - index;
+        index = next;
+    }
+    return 0;
+}
+
+void SkeletonStore::add_entry_block() {
+    size_t size = this->entry_blocks.size();
+    // tables hold a power of two pointers, so the current one is full when the block count is zero or a power of two
+    if ((size & (size - 1)) == 0) {
+        std::unique_ptr<Entry*[]> table(new Entry*[std::max<size_t>(size << 1, 1)]);
+        for (size_t index = 0; index < size; ++index) {
+            table[index] = this->entry_blocks[index].get();
+        }
+        this->entry_tables.push_back(std::move(table));
+    }
+    // entries are written before their ids are handed out, so the block is left uninitialized
+    this->entry_blocks.emplace_back(new Entry[entry_block_size]);
+    Entry** table = this->entry_tables.back().get();
+    table[size] = this->entry_blocks.back().get();
+    this->entry_table.store(table, std::memory_order_release);
+}
+
+const Twist* SkeletonStore::store_twists(const Twist* begin, const Twist* end) {
+    size_t length = end - begin;
+    if (length > this->twists_available) {
+        size_t size = std::max(length, twist_block_size);
+        this->twist_blocks.push_back(std::make_unique<Twist[]>(size));
+        this->twist_cursor = this->twist_blocks.back().get();
+        this->twists_available = size;
+    }
+    Twist* twists = this->twist_cursor;
+    std::copy(begin, end, twists);
+    this->twist_cursor += length;
+    this->twists_available -= length;
+    return twists;
+}
+
+void SkeletonStore::grow_table() {
+    std::vector<Id> table(this->table.size() << 1, SkeletonStore::none);
+    size_t mask = table.size() - 1;
+    for (Id id = 0; id < this->count; ++id) {
+        size_t slot = Details::mix_hash(this->entry(id).hash) & mask;
+        while (table[slot] != SkeletonStore::none) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = id;
+    }
+    this->table.swap(table);
+}
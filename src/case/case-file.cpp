@@ -0,0 +1,408 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ios>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+#if __has_include(<sys/mman.h>)
+#define INSERTIONFINDER_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <insertionfinder/algorithm.hpp>
+#include <insertionfinder/case.hpp>
+#include <insertionfinder/case-file.hpp>
+#include <insertionfinder/cube.hpp>
+#include <insertionfinder/utils.hpp>
+#include "../utils/encoding.hpp"
+using std::size_t;
+using std::int8_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+using InsertionFinder::Case;
+using InsertionFinder::CaseFile;
+using InsertionFinder::CaseStreamError;
+using InsertionFinder::Cube;
+using InsertionFinder::InsertionAlgorithm;
+namespace Details = InsertionFinder::Details;
+
+
+namespace {
+    // A version 1 file cannot start with these bytes unless it holds more than 2^56 cases.
+    constexpr char magic[8] = {'\xff', 'I', 'F', 'A', 'L', 'G', 'S', '\0'};
+
+    // All records are written in host byte order, so the version check also rejects files from hosts of the
+    // other endianness. Every table starts at a multiple of 8 bytes.
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t case_count;
+        uint64_t algorithm_count;
+        uint64_t twist_count;
+    };
+
+    struct CaseRecord {
+        uint64_t mask;
+        uint64_t first_algorithm;
+        uint32_t algorithm_count;
+        char state[21];
+        uint8_t parity;
+        int8_t corner_cycles;
+        int8_t edge_cycles;
+        uint8_t reserved[4];
+    };
+
+    struct AlgorithmRecord {
+        uint64_t first_twist;
+        uint32_t begin_mask;
+        uint32_t end_mask;
+        uint32_t set_up_mask;
+        uint16_t length;
+        uint8_t rotation;
+        uint8_t cancelled;
+    };
+
+    static_assert(sizeof(FileHeader) == 32);
+    static_assert(sizeof(CaseRecord) == 48);
+    static_assert(sizeof(AlgorithmRecord) == 24);
+
+    template<class T> T read_record(const char* data) noexcept {
+        T record;
+        std::memcpy(&record, data, sizeof(T));
+        return record;
+    }
+
+    template<class T> void write_record(std::ostream& out, const T& record) {
+        out.write(reinterpret_cast<const char*>(&record), sizeof(T));
+    }
+
+    void append_file(std::ostream& out, const std::string& path) {
+        std::ifstream fin(path, std::ios::in | std::ios::binary);
+        char buffer[1 << 16];
+        while (fin.read(buffer, sizeof(buffer)), fin.gcount()) {
+            out.write(buffer, fin.gcount());
+        }
+        if (fin.bad()) {
+            throw std::ios::failure("Failed to read " + path);
+        }
+    }
+
+    class MemoryBuffer: public std::streambuf {
+    public:
+        MemoryBuffer(const char* data, size_t size) {
+            char* begin = const_cast<char*>(data);
+            this->setg(begin, begin, begin + size);
+        }
+    };
+};
+
+
+CaseFile::CaseFile(const std::string& path) {
+#ifdef INSERTIONFINDER_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    struct stat status;
+    if (::fstat(fd, &status) == -1 || !S_ISREG(status.st_mode)) {
+        ::close(fd);
+        return;
+    }
+    this->size = status.st_size;
+    if (this->size) {
+        void* address = ::mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            return;
+        }
+        size_t size = this->size;
+        this->data.reset(static_cast<const char*>(address), [size](const char* data) {
+            ::munmap(const_cast<char*>(data), size);
+        });
+    }
+    ::close(fd);
+    this->failed = false;
+#else
+    std::ifstream fin(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (fin.fail()) {
+        return;
+    }
+    this->size = fin.tellg();
+    std::shared_ptr<char> buffer(new char[this->size], std::default_delete<char[]>());
+    fin.seekg(0);
+    fin.read(buffer.get(), this->size);
+    if (static_cast<size_t>(fin.gcount()) != this->size) {
+        return;
+    }
+    this->data = std::move(buffer);
+    this->failed = false;
+#endif
+}
+
+
+int CaseFile::version() const noexcept {
+    if (this->size >= sizeof(FileHeader) && std::memcmp(this->data.get(), magic, sizeof(magic)) == 0) {
+        return read_record<FileHeader>(this->data.get()).version;
+    }
+    return 1;
+}
+
+uint64_t CaseFile::content_hash() const noexcept {
+    const char* data = this->data.get();
+    uint64_t hash = Details::mix_hash(this->size);
+    size_t index = 0;
+    for (; index + 8 <= this->size; index += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + index, 8);
+        hash = Details::mix_hash(hash ^ word) + index;
+    }
+    if (index < this->size) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + index, this->size - index);
+        hash = Details::mix_hash(hash ^ word);
+    }
+    return hash;
+}
+
+void CaseFile::read_cases(std::vector<Case>& cases) const {
+    switch (this->version()) {
+        case 1:
+            this->read_cases_v1(cases);
+            break;
+        case 2:
+            this->read_cases_v2(cases);
+            break;
+        default:
+            throw CaseStreamError();
+    }
+}
+
+void CaseFile::read_cases_v1(std::vector<Case>& cases) const {
+    MemoryBuffer buffer(this->data.get(), this->size);
+    std::istream in(&buffer);
+    size_t size;
+    if (auto x = Details::read_varuint(in)) {
+        size = *x;
+    } else {
+        throw CaseStreamError();
+    }
+    for (size_t i = 0; i < size; ++i) {
+        Case _case;
+        _case.read_from(in);
+        cases.emplace_back(std::move(_case));
+    }
+}
+
+void CaseFile::read_cases_v2(std::vector<Case>& cases) const {
+    const char* data = this->data.get();
+    FileHeader header = read_record<FileHeader>(data);
+    size_t available = this->size - sizeof(FileHeader);
+    if (header.case_count > available / sizeof(CaseRecord)) {
+        throw CaseStreamError();
+    }
+    available -= header.case_count * sizeof(CaseRecord);
+    if (header.algorithm_count > available / sizeof(AlgorithmRecord)) {
+        throw CaseStreamError();
+    }
+    available -= header.algorithm_count * sizeof(AlgorithmRecord);
+    if (header.twist_count > available) {
+        throw CaseStreamError();
+    }
+    const char* case_table = data + sizeof(FileHeader);
+    const char* algorithm_table = case_table + header.case_count * sizeof(CaseRecord);
+    const char* twist_table = algorithm_table + header.algorithm_count * sizeof(AlgorithmRecord);
+
+    cases.reserve(cases.size() + header.case_count);
+    for (size_t i = 0; i < header.case_count; ++i) {
+        CaseRecord case_record = read_record<CaseRecord>(case_table + i * sizeof(CaseRecord));
+        if (
+            case_record.first_algorithm > header.algorithm_count
+            || case_record.algorithm_count > header.algorithm_count - case_record.first_algorithm
+        ) {
+            throw CaseStreamError();
+        }
+        Case& _case = cases.emplace_back();
+        _case.state.read_from(case_record.state);
+        _case.mask = case_record.mask;
+        _case.parity = case_record.parity;
+        _case.corner_cycles = case_record.corner_cycles;
+        _case.edge_cycles = case_record.edge_cycles;
+        _case.list.resize(case_record.algorithm_count);
+        const char* algorithm_data = algorithm_table + case_record.first_algorithm * sizeof(AlgorithmRecord);
+        for (InsertionAlgorithm& algorithm: _case.list) {
+            AlgorithmRecord record = read_record<AlgorithmRecord>(algorithm_data);
+            algorithm_data += sizeof(AlgorithmRecord);
+            if (record.first_twist > header.twist_count || record.length > header.twist_count - record.first_twist) {
+                cases.pop_back();
+                throw CaseStreamError();
+            }
+            const char* twists = twist_table + record.first_twist;
+            algorithm.twists.assign(twists, twists + record.length);
+            algorithm.rotation = record.rotation;
+            algorithm.rehash();
+            algorithm.begin_mask = record.begin_mask;
+            algorithm.end_mask = record.end_mask;
+            algorithm.set_up_mask = record.set_up_mask;
+            algorithm.cancelled = record.cancelled;
+        }
+        _case.insertion_masks.assign(_case.list);
+    }
+}
+
+
+void CaseFile::save_to(std::ostream& out, const std::vector<Case>& cases, int version) {
+    switch (version) {
+        case 1:
+            Details::write_varuint(out, cases.size());
+            for (const Case& _case: cases) {
+                _case.save_to(out);
+            }
+            break;
+        case 2:
+            CaseFile::save_to_v2(out, cases);
+            break;
+        default:
+            throw std::invalid_argument("Unsupported algorithm file version " + std::to_string(version));
+    }
+}
+
+void CaseFile::save_to_v2(std::ostream& out, const std::vector<Case>& cases) {
+    uint64_t algorithm_count = 0;
+    uint64_t twist_count = 0;
+    for (const Case& _case: cases) {
+        algorithm_count += _case.list.size();
+        for (const InsertionAlgorithm& algorithm: _case.list) {
+            twist_count += algorithm.length();
+        }
+    }
+    CaseFile::write_header(out, cases.size(), algorithm_count, twist_count);
+    uint64_t first_algorithm = 0;
+    for (const Case& _case: cases) {
+        CaseFile::write_case_record(out, _case, first_algorithm);
+        first_algorithm += _case.list.size();
+    }
+    uint64_t first_twist = 0;
+    for (const Case& _case: cases) {
+        first_twist = CaseFile::write_algorithm_records(out, _case, first_twist);
+    }
+    for (const Case& _case: cases) {
+        CaseFile::write_twists(out, _case);
+    }
+}
+
+void CaseFile::write_header(std::ostream& out, uint64_t case_count, uint64_t algorithm_count, uint64_t twist_count) {
+    FileHeader header {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = 2;
+    header.case_count = case_count;
+    header.algorithm_count = algorithm_count;
+    header.twist_count = twist_count;
+    write_record(out, header);
+}
+
+void CaseFile::write_case_record(std::ostream& out, const Case& _case, uint64_t first_algorithm) {
+    CaseRecord record {};
+    record.mask = _case.mask;
+    record.first_algorithm = first_algorithm;
+    record.algorithm_count = _case.list.size();
+    _case.state.save_to(record.state);
+    record.parity = _case.parity;
+    record.corner_cycles = _case.corner_cycles;
+    record.edge_cycles = _case.edge_cycles;
+    write_record(out, record);
+}
+
+uint64_t CaseFile::write_algorithm_records(std::ostream& out, const Case& _case, uint64_t first_twist) {
+    for (const InsertionAlgorithm& algorithm: _case.list) {
+        AlgorithmRecord record {};
+        record.first_twist = first_twist;
+        record.begin_mask = algorithm.begin_mask;
+        record.end_mask = algorithm.end_mask;
+        record.set_up_mask = algorithm.set_up_mask;
+        record.length = algorithm.length();
+        record.rotation = algorithm.rotation;
+        record.cancelled = algorithm.cancelled;
+        write_record(out, record);
+        first_twist += algorithm.length();
+    }
+    return first_twist;
+}
+
+void CaseFile::write_twists(std::ostream& out, const Case& _case) {
+    std::string twists;
+    for (const InsertionAlgorithm& algorithm: _case.list) {
+        for (size_t i = 0; i < algorithm.length(); ++i) {
+            twists.push_back(algorithm[i]);
+        }
+    }
+    out.write(twists.data(), twists.size());
+}
+
+
+CaseFile::Writer::Writer(const std::string& temporary_path, int version):
+    version(version), temporary_path(temporary_path) {
+    if (version < 1 || version > latest_version) {
+        throw std::invalid_argument("Unsupported algorithm file version " + std::to_string(version));
+    }
+    const auto mode = std::ios::out | std::ios::binary | std::ios::trunc;
+    this->case_table.open(this->table_path("cases"), mode);
+    if (version == 2) {
+        this->algorithm_table.open(this->table_path("algorithms"), mode);
+        this->twist_table.open(this->table_path("twists"), mode);
+    }
+    if (this->case_table.fail() || this->algorithm_table.fail() || this->twist_table.fail()) {
+        throw std::ios::failure("Failed to create " + this->temporary_path);
+    }
+}
+
+CaseFile::Writer::~Writer() {
+    this->case_table.close();
+    this->algorithm_table.close();
+    this->twist_table.close();
+    for (const char* table: {"cases", "algorithms", "twists"}) {
+        std::remove(this->table_path(table).c_str());
+    }
+}
+
+void CaseFile::Writer::write(const Case& _case) {
+    if (this->version == 1) {
+        _case.save_to(this->case_table);
+    } else {
+        CaseFile::write_case_record(this->case_table, _case, this->algorithm_count);
+        this->twist_count = CaseFile::write_algorithm_records(this->algorithm_table, _case, this->twist_count);
+        CaseFile::write_twists(this->twist_table, _case);
+    }
+    ++this->case_count;
+    this->algorithm_count += _case.list.size();
+}
+
+void CaseFile::Writer::finish(std::ostream& out) {
+    for (std::ofstream* table: {&this->case_table, &this->algorithm_table, &this->twist_table}) {
+        if (table->is_open()) {
+            table->close();
+            if (table->fail()) {
+                throw std::ios::failure("Failed to write " + this->temporary_path);
+            }
+        }
+    }
+    if (this->version == 1) {
+        Details::write_varuint(out, this->case_count);
+        append_file(out, this->table_path("cases"));
+    } else {
+        CaseFile::write_header(out, this->case_count, this->algorithm_count, this->twist_count);
+        append_file(out, this->table_path("cases"));
+        append_file(out, this->table_path("algorithms"));
+        append_file(out, this->table_path("twists"));
+    }
+}
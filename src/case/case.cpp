@@ -1,12 +1,18 @@
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <istream>
 #include <ostream>
 #include <insertionfinder/algorithm.hpp>
 #include <insertionfinder/case.hpp>
 #include <insertionfinder/cube.hpp>
+#include <insertionfinder/utils.hpp>
 #include "../utils/encoding.hpp"
+using std::size_t;
+using std::uint32_t;
 using std::uint64_t;
 using std::uint8_t;
+using InsertionFinder::Algorithm;
 using InsertionFinder::AlgorithmStreamError;
 using InsertionFinder::Case;
 using InsertionFinder::CaseStreamError;
@@ -48,6 +54,8 @@ void Case::read_from(std::istream& in) {
     } catch (const AlgorithmStreamError& e) {
         throw CaseStreamError();
     }
+    this->insertion_masks.assign(this->list);
+    this->drop_algorithm_index();
 }
 
 
@@ -77,3 +85,38 @@ int Case::compare(const Case& lhs, const Case& rhs) noexcept {
     }
     return Cube::compare(lhs.state, rhs.state);
 }
+
+
+size_t Case::find_algorithm_slot(const Algorithm& algorithm) const noexcept {
+    size_t mask = this->algorithm_index.size() - 1;
+    size_t slot = Details::mix_hash(std::hash<Algorithm>()(algorithm)) & mask;
+    while (uint32_t position = this->algorithm_index[slot]) {
+        if (this->list[position - 1] == algorithm) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void Case::build_algorithm_index(size_t capacity) {
+    size_t size = 64;
+    while (size < capacity << 1) {
+        size <<= 1;
+    }
+    if (size <= this->algorithm_index.size()) {
+        return;
+    }
+    this->algorithm_index.assign(size, 0);
+    for (size_t index = 0; index < this->list.size(); ++index) {
+        this->algorithm_index[this->find_algorithm_slot(this->list[index])] = index + 1;
+    }
+}
+
+void Case::index_algorithm(size_t index) {
+    if (this->list.size() << 1 > this->algorithm_index.size()) {
+        this->build_algorithm_index(this->list.size());
+    } else {
+        this->algorithm_index[this->find_algorithm_slot(this->list[index])] = index + 1;
+    }
+}
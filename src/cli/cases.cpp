@@ -0,0 +1,163 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <config.h>
+#include <insertionfinder/fallbacks/filesystem.hpp>
+#include <insertionfinder/case.hpp>
+#include <insertionfinder/case-file.hpp>
+#include <insertionfinder/cube.hpp>
+#include <insertionfinder/utils.hpp>
+#include "utils.hpp"
+using std::size_t;
+using std::uint64_t;
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+using InsertionFinder::Case;
+using InsertionFinder::CaseFile;
+using InsertionFinder::CaseStreamError;
+using InsertionFinder::Cube;
+namespace Details = InsertionFinder::Details;
+
+
+namespace {
+    std::optional<fs::path> get_cache_directory(const po::variables_map& vm) {
+        if (vm.count("no-cache")) {
+            return {};
+        }
+        if (vm.count("cache-dir")) {
+            return fs::path(vm["cache-dir"].as<std::string>());
+        }
+        if (const char* directory = std::getenv("XDG_CACHE_HOME"); directory && *directory) {
+            return fs::path(directory) / PACKAGE;
+        }
+        if (const char* directory = std::getenv("HOME"); directory && *directory) {
+            return fs::path(directory) / ".cache" / PACKAGE;
+        }
+        return {};
+    }
+
+    // Bump whenever the way cases are merged or sorted into a cache changes.
+    constexpr uint64_t cache_format = 1;
+
+    // Identifies the running executable, so that a cache written by a different build is never loaded.
+    uint64_t get_build_stamp() {
+        try {
+            const fs::path executable = fs::read_symlink("/proc/self/exe");
+            const auto time = fs::last_write_time(executable);
+#ifdef INSERTIONFINDER_HAVE_FILESYSTEM
+            const uint64_t stamp = time.time_since_epoch().count();
+#else
+            const uint64_t stamp = time;
+#endif
+            return Details::mix_hash(stamp ^ Details::mix_hash(fs::file_size(executable)));
+        } catch (const fs::filesystem_error& e) {
+            return 0;
+        }
+    }
+
+    // The merged case set depends on the build, the contents of the algorithm files and the order they are merged in.
+    fs::path get_cache_path(const fs::path& directory, const std::vector<std::pair<std::string, CaseFile>>& files) {
+        uint64_t key = std::hash<std::string>()(VERSION) ^ CaseFile::latest_version;
+        key ^= Details::mix_hash(cache_format ^ get_build_stamp());
+        for (const auto& [name, file]: files) {
+            key ^= file.content_hash() + 0x9e3779b97f4a7c15 + (key << 6) + (key >> 2);
+        }
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << key << ".algs";
+        return directory / name.str();
+    }
+
+    void save_cache(const fs::path& path, const std::vector<Case>& cases) {
+        fs::path temporary_path = path;
+        temporary_path += ".tmp-" + std::to_string(std::random_device()());
+        try {
+            fs::create_directories(path.parent_path());
+            {
+                std::ofstream fout(temporary_path.string(), std::ios::out | std::ios::binary);
+                CaseFile::save_to(fout, cases);
+                if (!fout.good()) {
+                    throw std::ios::failure("Failed to write " + temporary_path.string());
+                }
+            }
+            fs::rename(temporary_path, path);
+        } catch (const std::exception& e) {
+            try {
+                fs::remove(temporary_path);
+            } catch (const fs::filesystem_error&) {}
+        }
+    }
+};
+
+
+std::vector<Case> Details::load_cases(const po::variables_map& vm, const std::vector<std::string>& algfilenames) {
+    const fs::path algorithms_directory = vm["algs-dir"].as<std::string>();
+    std::vector<std::pair<std::string, CaseFile>> files;
+    for (const std::string& name: algfilenames) {
+        CaseFile file(name);
+        if (file.fail()) {
+            file = CaseFile((algorithms_directory / (name + ".algs")).string());
+            if (file.fail()) {
+                std::cerr << "Failed to open algorithm file " << name << std::endl;
+                continue;
+            }
+        }
+        files.emplace_back(name, std::move(file));
+    }
+
+    std::optional<fs::path> cache_path;
+    if (auto cache_directory = get_cache_directory(vm)) {
+        cache_path = get_cache_path(*cache_directory, files);
+        CaseFile cache(cache_path->string());
+        if (!cache.fail() && cache.version() == CaseFile::latest_version) {
+            std::vector<Case> cases;
+            try {
+                cache.read_cases(cases);
+                return cases;
+            } catch (const CaseStreamError& e) {}
+        }
+    }
+
+    bool complete = true;
+    std::unordered_map<Cube, Case> map;
+    for (const auto& [name, file]: files) {
+        std::vector<Case> file_cases;
+        try {
+            file.read_cases(file_cases);
+        } catch (...) {
+            std::cerr << "Invalid algorithm file " << name << std::endl;
+            complete = false;
+        }
+        for (Case& _case: file_cases) {
+            auto [node, inserted] = map.try_emplace(_case.get_state(), std::move(_case));
+            if (!inserted) {
+                node->second.merge_algorithms(std::move(_case));
+            }
+        }
+    }
+
+    std::vector<Case> cases;
+    cases.reserve(map.size());
+    for (auto& node: map) {
+        cases.emplace_back(std::move(node.second));
+        cases.back().drop_algorithm_index();
+    }
+    std::sort(cases.begin(), cases.end(), [](const Case& x, const Case& y) {return Case::compare(x, y) < 0;});
+
+    if (cache_path && complete) {
+        save_cache(*cache_path, cases);
+    }
+    return cases;
+}
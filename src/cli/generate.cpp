@@ -1,100 +1,492 @@
 #include <cstddef>
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <random>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 #include <boost/program_options.hpp>
+#include <insertionfinder/fallbacks/filesystem.hpp>
 #include <insertionfinder/algorithm.hpp>
 #include <insertionfinder/case.hpp>
+#include <insertionfinder/case-file.hpp>
 #include <insertionfinder/cube.hpp>
-#include "../utils/encoding.hpp"
 #include "commands.hpp"
 using std::size_t;
+namespace fs = std::filesystem;
 namespace po = boost::program_options;
 using InsertionFinder::Algorithm;
 using InsertionFinder::AlgorithmError;
 using InsertionFinder::Case;
+using InsertionFinder::CaseFile;
 using InsertionFinder::Cube;
+using InsertionFinder::InsertionAlgorithm;
 namespace CLI = InsertionFinder::CLI;
-namespace Details = InsertionFinder::Details;
 
 
-void CLI::generate_algorithms(const po::variables_map& vm) {
-    const std::vector<std::string> filenames =
-        vm.count("file") ? vm["file"].as<std::vector<std::string>>() : std::vector<std::string>();
-    const std::vector<std::string> algfilenames =
-        vm.count("algfile") ? vm["algfile"].as<std::vector<std::string>>() : std::vector<std::string>();
+namespace {
+    struct Line {
+        std::string text;
+        std::optional<std::string> error;
+        Algorithm algorithm;
+        bool valid = false;
+        bool skipped = false;
+        std::vector<Algorithm> similars;
+    };
 
-    std::unordered_map<Cube, Case> map;
+    // Calls f(worker, begin, end) on consecutive chunks of [0, size), handed out to the workers in turn.
+    template<class F> void parallel_for(size_t jobs, size_t size, size_t chunk_size, const F& f) {
+        const size_t chunk_count = (size + chunk_size - 1) / chunk_size;
+        std::atomic<size_t> next_chunk = 0;
+        std::exception_ptr exception;
+        std::mutex exception_mutex;
+        auto run = [&](size_t worker) {
+            try {
+                for (size_t chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++) {
+                    f(worker, chunk * chunk_size, std::min(size, (chunk + 1) * chunk_size));
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+                next_chunk = chunk_count;
+            }
+        };
+        jobs = std::min(jobs, chunk_count);
+        if (jobs <= 1) {
+            run(0);
+        } else {
+            std::vector<std::thread> threads;
+            for (size_t worker = 0; worker < jobs; ++worker) {
+                threads.emplace_back(run, worker);
+            }
+            for (std::thread& thread: threads) {
+                thread.join();
+            }
+        }
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    // Expanding a line generates up to a few thousand algorithms, so expansions are handed out in smaller chunks.
+    constexpr size_t chunk_size = 256;
+    constexpr size_t expansion_chunk_size = 16;
 
-    for (const std::string& name: filenames) {
-        std::ifstream fin(name);
-        if (fin.fail()) {
-            std::cerr << "Failed to open file " << name << std::endl;
-            continue;
+    void prepare_line(Line& line) {
+        try {
+            line.algorithm = Algorithm(line.text);
+        } catch (const AlgorithmError& e) {
+            line.error = e.what();
+            return;
         }
-        while (!fin.eof()) {
-            std::string line;
-            std::getline(fin, line);
-            Algorithm algorithm;
-            try {
-                algorithm = Algorithm(line);
-            } catch (const AlgorithmError& e) {
-                std::cerr << "Invalid algorithm: " << e.what() << std::endl;
+        std::string().swap(line.text);
+        line.algorithm.simplify();
+        line.algorithm.normalize();
+        line.algorithm.detect_rotation();
+        line.valid = (Cube() * line.algorithm).mask() != 0;
+    }
+
+    void expand_line(Line& line, bool symmetrics_only) {
+        line.similars = symmetrics_only ? line.algorithm.generate_symmetrics() : line.algorithm.generate_similars();
+    }
+
+    // Rough memory use, in bytes, of what generation keeps per line, per generated algorithm and per case. The
+    // algorithm list of a case may have twice the capacity it uses, plus the slots of its hashed index.
+    constexpr size_t line_cost = sizeof(std::pair<const Algorithm, bool>) + 32;
+    constexpr size_t expansion_cost = sizeof(Algorithm);
+    constexpr size_t algorithm_cost = sizeof(InsertionAlgorithm) * 2 + 16;
+    constexpr size_t case_cost = sizeof(Case) + sizeof(Cube) + 64;
+
+    // Calls process on the lines of the files in order, at most batch_size lines at a time. process may change
+    // batch_size for the batches that follow.
+    void for_each_batch(
+        const std::vector<std::string>& filenames, bool report, const size_t& batch_size,
+        const std::function<void(std::vector<Line>&)>& process
+    ) {
+        std::vector<Line> lines;
+        for (const std::string& name: filenames) {
+            std::ifstream fin(name);
+            if (fin.fail()) {
+                if (report) {
+                    process(lines);
+                    lines.clear();
+                    std::cerr << "Failed to open file " << name << std::endl;
+                }
                 continue;
             }
-            algorithm.simplify();
-            algorithm.normalize();
-            algorithm.detect_rotation();
-            Cube cube = Cube() * algorithm;
-            if (cube.mask() == 0) {
-                continue;
+            while (!fin.eof()) {
+                std::getline(fin, lines.emplace_back().text);
+                if (lines.size() >= batch_size) {
+                    process(lines);
+                    lines.clear();
+                }
             }
+        }
+        process(lines);
+    }
 
-            if (auto node = map.find(cube); node != map.end() && node->second.contains_algorithm(algorithm)) {
-                continue;
+    // Collects the algorithms of all valid lines, each marked as not generated yet.
+    std::unordered_map<Algorithm, bool> collect_lines(const std::vector<std::string>& filenames, size_t jobs) {
+        constexpr size_t batch_size = 1024;
+        std::unordered_map<Algorithm, bool> generated;
+        for_each_batch(filenames, true, batch_size, [&](std::vector<Line>& lines) {
+            parallel_for(jobs, lines.size(), chunk_size, [&](size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    prepare_line(lines[i]);
+                }
+            });
+            for (const Line& line: lines) {
+                if (line.error) {
+                    std::cerr << "Invalid algorithm: " << *line.error << std::endl;
+                } else if (line.valid) {
+                    generated.emplace(line.algorithm, false);
+                }
+            }
+        });
+        return generated;
+    }
+
+    // Expands the lines that are not skipped one batch at a time, and hands the algorithms of each such line to
+    // consume on the worker that expanded it. A line is skipped when an earlier line that was not skipped itself
+    // already generated its algorithm, which generated records for the algorithm of every line, so no expansion is
+    // kept past its batch. Batches start small and grow only while their expansions fit in expansion_limit bytes.
+    void expand_lines(
+        const std::vector<std::string>& filenames, bool symmetrics_only, size_t jobs, size_t expansion_limit,
+        std::unordered_map<Algorithm, bool>& generated,
+        const std::function<void(size_t, std::vector<Algorithm>&)>& consume
+    ) {
+        constexpr size_t max_batch_size = 1024;
+        size_t batch_size = expansion_chunk_size;
+        for_each_batch(filenames, false, batch_size, [&](std::vector<Line>& lines) {
+            auto is_generated = [&](const Algorithm& algorithm) {
+                auto node = generated.find(algorithm);
+                return node != generated.end() && node->second;
+            };
+            parallel_for(jobs, lines.size(), expansion_chunk_size, [&](size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    prepare_line(lines[i]);
+                    if (lines[i].valid && !is_generated(lines[i].algorithm)) {
+                        expand_line(lines[i], symmetrics_only);
+                    }
+                }
+            });
+            size_t expansion_size = lines.size() * sizeof(Line);
+            for (Line& line: lines) {
+                expansion_size += line.similars.size() * expansion_cost;
+                if (!line.valid || is_generated(line.algorithm)) {
+                    line.skipped = true;
+                    continue;
+                }
+                for (const Algorithm& algorithm: line.similars) {
+                    if (auto node = generated.find(algorithm); node != generated.end()) {
+                        node->second = true;
+                    }
+                }
+            }
+            if (!lines.empty()) {
+                const size_t fitting_size = expansion_limit / std::max<size_t>(expansion_size / lines.size(), 1);
+                batch_size = std::clamp<size_t>(fitting_size, 1, std::min(batch_size * 2, max_batch_size));
+            }
+            parallel_for(jobs, lines.size(), expansion_chunk_size, [&](size_t worker, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    if (!lines[i].skipped) {
+                        consume(worker, lines[i].similars);
+                    }
+                    std::vector<Algorithm>().swap(lines[i].similars);
+                }
+            });
+        });
+    }
+
+    std::vector<Case> generate_in_memory(const std::vector<std::string>& filenames, bool symmetrics_only, size_t jobs) {
+        std::unordered_map<Algorithm, bool> generated = collect_lines(filenames, jobs);
+        std::vector<std::unordered_map<Cube, Case>> partial_maps(jobs);
+        auto add_algorithms = [&](size_t worker, std::vector<Algorithm>& algorithms) {
+            std::unordered_map<Cube, Case>& map = partial_maps[worker];
+            for (Algorithm& algorithm: algorithms) {
+                Cube cube = Cube() * algorithm;
+                map.try_emplace(cube, cube).first->second.add_algorithm(std::move(algorithm));
+            }
+        };
+        expand_lines(
+            filenames, symmetrics_only, jobs, std::numeric_limits<size_t>::max(), generated, add_algorithms
+        );
+        std::unordered_map<Algorithm, bool>().swap(generated);
+
+        std::unordered_map<Cube, Case> map = std::move(partial_maps.front());
+        for (size_t worker = 1; worker < jobs; ++worker) {
+            for (auto& node: partial_maps[worker]) {
+                auto [merged_node, inserted] = map.try_emplace(node.first, std::move(node.second));
+                if (!inserted) {
+                    merged_node->second.merge_algorithms(std::move(node.second));
+                }
+            }
+            std::unordered_map<Cube, Case>().swap(partial_maps[worker]);
+        }
+
+        std::vector<Case> cases;
+        cases.reserve(map.size());
+        for (auto& node: map) {
+            cases.emplace_back(std::move(node.second));
+        }
+        parallel_for(jobs, cases.size(), chunk_size, [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                cases[i].sort_algorithms();
+            }
+        });
+        std::sort(cases.begin(), cases.end(), [](const Case& x, const Case& y) {return Case::compare(x, y) < 0;});
+        return cases;
+    }
+
+
+    // A temporary directory of sorted runs, each a sequence of cases as written by Case::save_to.
+    class RunDirectory {
+    private:
+        fs::path directory;
+        std::vector<fs::path> runs;
+        size_t run_count = 0;
+        std::mutex mutex;
+    public:
+        RunDirectory() {
+            this->directory = fs::temp_directory_path() / ("insertionfinder-" + std::to_string(std::random_device()()));
+            fs::create_directories(this->directory);
+        }
+        RunDirectory(const RunDirectory&) = delete;
+        RunDirectory& operator=(const RunDirectory&) = delete;
+        ~RunDirectory() {
+            try {
+                fs::remove_all(this->directory);
+            } catch (const fs::filesystem_error&) {}
+        }
+    public:
+        fs::path path(const std::string& name) const {
+            return this->directory / name;
+        }
+        fs::path new_run() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            return this->directory / ("run-" + std::to_string(this->run_count++));
+        }
+        void add_run(const fs::path& path) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->runs.push_back(path);
+        }
+        std::vector<fs::path> take_runs() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            return std::move(this->runs);
+        }
+    };
+
+    class RunWriter {
+    private:
+        fs::path path;
+        std::ofstream fout;
+    public:
+        explicit RunWriter(const fs::path& path): path(path), fout(path.string(), std::ios::out | std::ios::binary) {}
+    public:
+        void write(const Case& _case) {
+            _case.save_to(this->fout);
+        }
+        void close() {
+            this->fout.close();
+            if (this->fout.fail()) {
+                throw CLI::CommandExecutionError("Failed to write temporary file " + this->path.string());
+            }
+        }
+    };
+
+    class RunReader {
+    private:
+        std::ifstream fin;
+    public:
+        Case head;
+    public:
+        explicit RunReader(const fs::path& path): fin(path.string(), std::ios::in | std::ios::binary) {
+            if (this->fin.fail()) {
+                throw CLI::CommandExecutionError("Failed to open temporary file " + path.string());
+            }
+        }
+    public:
+        bool next() {
+            if (this->fin.peek() == std::ifstream::traits_type::eof()) {
+                return false;
+            }
+            this->head.read_from(this->fin);
+            return true;
+        }
+    };
+
+    // The generated cases of a worker that have not been spilled yet, with a rough count of the memory they use.
+    struct RunBuffer {
+        std::unordered_map<Cube, Case> map;
+        size_t size = 0;
+    };
+
+    void spill(RunBuffer& buffer, RunDirectory& directory) {
+        std::vector<Case> cases;
+        cases.reserve(buffer.map.size());
+        for (auto& node: buffer.map) {
+            cases.emplace_back(std::move(node.second));
+            cases.back().sort_algorithms();
+        }
+        std::unordered_map<Cube, Case>().swap(buffer.map);
+        buffer.size = 0;
+        std::sort(cases.begin(), cases.end(), [](const Case& x, const Case& y) {return Case::compare(x, y) < 0;});
+        fs::path path = directory.new_run();
+        RunWriter writer(path);
+        for (const Case& _case: cases) {
+            writer.write(_case);
+        }
+        writer.close();
+        directory.add_run(path);
+    }
+
+    // Merges sorted runs into one sorted sequence of cases, joining the algorithms of equal cases.
+    void merge_runs(const std::vector<fs::path>& runs, const std::function<void(const Case&)>& output) {
+        std::vector<std::unique_ptr<RunReader>> readers;
+        for (const fs::path& path: runs) {
+            readers.emplace_back(std::make_unique<RunReader>(path));
+        }
+        auto later = [&](size_t x, size_t y) {return Case::compare(readers[x]->head, readers[y]->head) > 0;};
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> queue(later);
+        for (size_t index = 0; index < readers.size(); ++index) {
+            if (readers[index]->next()) {
+                queue.push(index);
             }
-            std::vector<Algorithm> algorithms = vm.count("symmetrics-only")
-                ? algorithm.generate_symmetrics()
-                : algorithm.generate_similars();
-            for (Algorithm& alg: algorithms) {
-                Cube cube = Cube() * alg;
-                if (auto node = map.find(cube); node != map.end()) {
-                    node->second.add_algorithm(std::move(alg));
-                } else {
-                    Case _case(cube);
-                    _case.add_algorithm(std::move(alg));
-                    map.emplace(cube, std::move(_case));
+        }
+        while (!queue.empty()) {
+            size_t index = queue.top();
+            queue.pop();
+            Case _case = std::move(readers[index]->head);
+            if (readers[index]->next()) {
+                queue.push(index);
+            }
+            while (!queue.empty() && Case::compare(readers[queue.top()]->head, _case) == 0) {
+                index = queue.top();
+                queue.pop();
+                _case.merge_algorithms(std::move(readers[index]->head));
+                if (readers[index]->next()) {
+                    queue.push(index);
                 }
             }
+            _case.sort_algorithms();
+            output(_case);
         }
     }
 
-    size_t size = map.size();
-    std::vector<Case> cases;
-    cases.reserve(size);
-    for (auto& node: map) {
-        cases.emplace_back(std::move(node.second));
+    // The algorithms of the lines are kept throughout. Of what is left of memory_limit bytes, a quarter goes to the
+    // expansions of a batch and the rest to the buffers of the workers, which are spilled to sorted runs when full.
+    void generate_out_of_core(
+        const std::vector<std::string>& filenames, bool symmetrics_only, size_t jobs, size_t memory_limit,
+        bool verbose, RunDirectory& directory, CaseFile::Writer& writer
+    ) {
+        constexpr size_t max_fan_in = 64;
+        std::unordered_map<Algorithm, bool> generated = collect_lines(filenames, jobs);
+        const size_t lines_size = generated.size() * line_cost;
+        const size_t available = memory_limit > lines_size ? memory_limit - lines_size : 0;
+        const size_t expansion_limit = available / 4;
+        const size_t buffer_limit = std::max<size_t>((available - expansion_limit) / jobs, 1);
+        std::vector<RunBuffer> buffers(jobs);
+        auto add_algorithms = [&](size_t worker, std::vector<Algorithm>& algorithms) {
+            RunBuffer& buffer = buffers[worker];
+            for (Algorithm& algorithm: algorithms) {
+                Cube cube = Cube() * algorithm;
+                auto [node, inserted] = buffer.map.try_emplace(cube, cube);
+                size_t algorithm_count = node->second.algorithm_list().size();
+                node->second.add_algorithm(std::move(algorithm));
+                buffer.size += (inserted ? case_cost : 0)
+                    + (node->second.algorithm_list().size() - algorithm_count) * algorithm_cost;
+            }
+            if (buffer.size >= buffer_limit) {
+                spill(buffer, directory);
+            }
+        };
+        expand_lines(filenames, symmetrics_only, jobs, expansion_limit, generated, add_algorithms);
+        std::unordered_map<Algorithm, bool>().swap(generated);
+        for (RunBuffer& buffer: buffers) {
+            if (!buffer.map.empty()) {
+                spill(buffer, directory);
+            }
+        }
+
+        std::vector<fs::path> runs = directory.take_runs();
+        if (verbose) {
+            std::cerr << "Merging " << runs.size() << " sorted runs" << std::endl;
+        }
+        while (runs.size() > max_fan_in) {
+            for (size_t begin = 0; begin < runs.size(); begin += max_fan_in) {
+                std::vector<fs::path> group(
+                    runs.begin() + begin,
+                    runs.begin() + std::min(runs.size(), begin + max_fan_in)
+                );
+                fs::path path = directory.new_run();
+                RunWriter run_writer(path);
+                merge_runs(group, [&](const Case& _case) {run_writer.write(_case);});
+                run_writer.close();
+                for (const fs::path& run: group) {
+                    fs::remove(run);
+                }
+                directory.add_run(path);
+            }
+            runs = directory.take_runs();
+        }
+        merge_runs(runs, [&](const Case& _case) {writer.write(_case);});
     }
-    std::sort(cases.begin(), cases.end(), [](const Case& x, const Case& y) {return Case::compare(x, y) < 0;});
 
-    std::shared_ptr<std::ostream> out;
-    if (algfilenames.empty()) {
-        out.reset(&std::cout, [](std::ostream*) {});
-    } else {
+    std::shared_ptr<std::ostream> open_output(const std::vector<std::string>& algfilenames) {
+        if (algfilenames.empty()) {
+            return std::shared_ptr<std::ostream>(&std::cout, [](std::ostream*) {});
+        }
         const std::string& name = algfilenames.front();
-        out = std::make_shared<std::ofstream>(name, std::ios::out | std::ios::binary);
+        auto out = std::make_shared<std::ofstream>(name, std::ios::out | std::ios::binary);
         if (out->fail()) {
             throw CLI::CommandExecutionError("Failed to open output file " + name);
         }
+        return out;
+    }
+};
+
+
+void CLI::generate_algorithms(const po::variables_map& vm) {
+    const std::vector<std::string> filenames =
+        vm.count("file") ? vm["file"].as<std::vector<std::string>>() : std::vector<std::string>();
+    const std::vector<std::string> algfilenames =
+        vm.count("algfile") ? vm["algfile"].as<std::vector<std::string>>() : std::vector<std::string>();
+    const int version = vm["algs-version"].as<int>();
+    if (version < 1 || version > CaseFile::latest_version) {
+        throw CLI::CommandExecutionError("Unsupported algorithm file version " + std::to_string(version));
     }
-    Details::write_varuint(*out, size);
-    for (Case& _case: cases) {
-        _case.sort_algorithms();
-        _case.save_to(*out);
+    const bool symmetrics_only = vm.count("symmetrics-only");
+    const size_t jobs = std::max<size_t>(vm["jobs"].as<size_t>(), 1);
+
+    if (vm.count("memory-limit")) {
+        const size_t memory_limit = vm["memory-limit"].as<size_t>() << 20;
+        try {
+            RunDirectory directory;
+            CaseFile::Writer writer(directory.path("output").string(), version);
+            generate_out_of_core(
+                filenames, symmetrics_only, jobs, memory_limit, vm.count("verbose"), directory, writer
+            );
+            writer.finish(*open_output(algfilenames));
+        } catch (const fs::filesystem_error& e) {
+            throw CLI::CommandExecutionError(e.what());
+        } catch (const std::ios::failure& e) {
+            throw CLI::CommandExecutionError(e.what());
+        }
+    } else {
+        std::vector<Case> cases = generate_in_memory(filenames, symmetrics_only, jobs);
+        CaseFile::save_to(*open_output(algfilenames), cases, version);
     }
 }
@@ -1,28 +1,23 @@
 #include <cstddef>
-#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <limits>
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 #include <boost/program_options.hpp>
 #include <univalue.h>
-#include <insertionfinder/fallbacks/filesystem.hpp>
 #include <insertionfinder/algorithm.hpp>
 #include <insertionfinder/case.hpp>
 #include <insertionfinder/cube.hpp>
 #include <insertionfinder/termcolor.hpp>
 #include <insertionfinder/improver/improver.hpp>
 #include <insertionfinder/improver/slice.hpp>
-#include "../utils/encoding.hpp"
 #include "commands.hpp"
 #include "utils.hpp"
 using std::size_t;
-namespace fs = std::filesystem;
 namespace po = boost::program_options;
 using InsertionFinder::Algorithm;
 using InsertionFinder::Case;
@@ -96,6 +91,7 @@ namespace {
             }
             map.pushKV("solutions", solution_list);
             map.pushKV("duration", result.duration);
+            map.pushKV("cube_kernels", Cube::kernel_name());
             std::cout << map.write() << std::flush;
         }
     };
@@ -105,48 +101,10 @@ namespace {
 void CLI::find_improvements(const po::variables_map& vm) {
     const std::vector<std::string> filenames =
         vm.count("file") ? vm["file"].as<std::vector<std::string>>() : std::vector<std::string>();
-    const fs::path algorithms_directory = vm["algs-dir"].as<std::string>();
-    std::vector<std::string> algfilenames =
+    const std::vector<std::string> algfilenames =
         vm.count("algfile") ? vm["algfile"].as<std::vector<std::string>>() : std::vector<std::string>();
 
-    std::unordered_map<Cube, Case> map;
-    for (const std::string& name: algfilenames) {
-        std::ifstream fin(name, std::ios::in | std::ios::binary);
-        if (fin.fail()) {
-            fin = std::ifstream((algorithms_directory / (name + ".algs")).string(), std::ios::in | std::ios::binary);
-            if (fin.fail()) {
-                std::cerr << "Failed to open algorithm file " << name << std::endl;
-                continue;
-            }
-        }
-        size_t size;
-        if (auto x = Details::read_varuint(fin)) {
-            size = *x;
-        } else {
-            std::cerr << "Invalid algorithm file " << name << std::endl;
-            continue;
-        }
-        for (size_t i = 0; i < size; ++i) {
-            Case _case;
-            try {
-                _case.read_from(fin);
-            } catch (...) {
-                std::cerr << "Invalid algorithm file " << name << std::endl;
-                break;
-            }
-            auto [node, inserted] = map.try_emplace(_case.get_state(), std::move(_case));
-            if (!inserted) {
-                node->second.merge_algorithms(std::move(_case));
-            }
-        }
-    }
-
-    std::vector<Case> cases;
-    cases.reserve(map.size());
-    for (auto& node: map) {
-        cases.emplace_back(std::move(node.second));
-    }
-    std::sort(cases.begin(), cases.end(), [](const Case& x, const Case& y) {return Case::compare(x, y) < 0;});
+    const std::vector<Case> cases = Details::load_cases(vm, algfilenames);
 
     std::shared_ptr<std::istream> in;
     if (filenames.empty()) {
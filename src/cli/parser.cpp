@@ -6,9 +6,11 @@
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <config.h>
+#include <insertionfinder/cube.hpp>
 #include "parser.hpp"
 #include "commands.hpp"
 using std::size_t;
+using InsertionFinder::Cube;
 namespace po = boost::program_options;
 namespace pt = boost::property_tree;
 namespace CLI = InsertionFinder::CLI;
@@ -46,6 +48,8 @@ void CLI::parse(int argc, char** argv) try {
         )
         ("all-algs", "all algorithms")
         ("all-extra-algs", "all extra algorithms")
+        ("cache-dir", po::value<std::string>(), "merged algorithm cache directory (never evicted)")
+        ("no-cache", "do not cache merged algorithms")
         ("file,f", po::value<std::vector<std::string>>(), "input file")
         ("optimal,o", "search for optimal solutions")
         ("target", po::value<size_t>(), "search target")
@@ -73,6 +77,16 @@ void CLI::parse(int argc, char** argv) try {
             "multiple threads"
         )
         ("symmetrics-only", "generate only symmetric algorithms")
+        (
+            "algs-version",
+            po::value<int>()->default_value(1),
+            "generated algorithm file version"
+        )
+        (
+            "memory-limit",
+            po::value<size_t>(),
+            "keep generated algorithms within about this many MiB, spilling sorted runs to temporary files"
+        )
         ("expand-insertions", "show expanded insertions")
         ("json", "use JSON output")
         ("verbose", "verbose");
@@ -88,6 +102,7 @@ void CLI::parse(int argc, char** argv) try {
     }
     if (vm.count("version")) {
         std::cout << version_string << std::endl;
+        std::cout << "Cube kernels: " << Cube::kernel_name() << std::endl;
         return;
     }
     if (vm.count("solve")) {
@@ -1,11 +1,9 @@
 #include <cstddef>
-#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <limits>
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <boost/program_options.hpp>
@@ -18,7 +16,6 @@
 #include <insertionfinder/finder/finder.hpp>
 #include <insertionfinder/finder/brute-force.hpp>
 #include <insertionfinder/finder/greedy.hpp>
-#include "../utils/encoding.hpp"
 #include "commands.hpp"
 #include "utils.hpp"
 using std::size_t;
@@ -175,6 +172,7 @@ namespace {
             }
             map.pushKV("solutions", solution_list);
             map.pushKV("duration", result.duration);
+            map.pushKV("cube_kernels", Cube::kernel_name());
             std::cout << map.write() << std::flush;
         }
     };
@@ -210,44 +208,7 @@ void CLI::find_insertions(const po::variables_map& vm) {
         }
     }
 
-    std::unordered_map<Cube, Case> map;
-    for (const std::string& name: algfilenames) {
-        std::ifstream fin(name, std::ios::in | std::ios::binary);
-        if (fin.fail()) {
-            fin = std::ifstream((algorithms_directory / (name + ".algs")).string(), std::ios::in | std::ios::binary);
-            if (fin.fail()) {
-                std::cerr << "Failed to open algorithm file " << name << std::endl;
-                continue;
-            }
-        }
-        size_t size;
-        if (auto x = Details::read_varuint(fin)) {
-            size = *x;
-        } else {
-            std::cerr << "Invalid algorithm file " << name << std::endl;
-            continue;
-        }
-        for (size_t i = 0; i < size; ++i) {
-            Case _case;
-            try {
-                _case.read_from(fin);
-            } catch (...) {
-                std::cerr << "Invalid algorithm file " << name << std::endl;
-                break;
-            }
-            auto [node, inserted] = map.try_emplace(_case.get_state(), std::move(_case));
-            if (!inserted) {
-                node->second.merge_algorithms(std::move(_case));
-            }
-        }
-    }
-
-    std::vector<Case> cases;
-    cases.reserve(map.size());
-    for (auto& node: map) {
-        cases.emplace_back(std::move(node.second));
-    }
-    std::sort(cases.begin(), cases.end(), [](const Case& x, const Case& y) {return Case::compare(x, y) < 0;});
+    const std::vector<Case> cases = Details::load_cases(vm, algfilenames);
 
     std::shared_ptr<std::istream> in;
     if (filenames.empty()) {
@@ -1,11 +1,17 @@
 #pragma once
 #include <cstdint>
 #include <ostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
 #include <univalue.h>
+#include <insertionfinder/case.hpp>
 #include <insertionfinder/insertion.hpp>
 
 namespace InsertionFinder::Details {
     void print_duration(std::ostream& out, std::int64_t duration);
     UniValue
     create_json_solution(const InsertionFinder::Algorithm& skeleton, const InsertionFinder::Solution& solution);
+    std::vector<InsertionFinder::Case>
+    load_cases(const boost::program_options::variables_map& vm, const std::vector<std::string>& algfilenames);
 };
@@ -0,0 +1,291 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <insertionfinder/cube.hpp>
+#include "kernels.hpp"
+#include "utils.hpp"
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+using InsertionFinder::Cube;
+using InsertionFinder::CubeBatch;
+namespace CubeTwist = InsertionFinder::CubeTwist;
+namespace Details = InsertionFinder::Details;
+
+
+namespace {
+    constexpr size_t block_size = 32;
+
+    struct CornerCycles {
+        static uint8_t twist(uint8_t item, uint8_t transform) noexcept {
+            return Details::twist_corner(item, transform);
+        }
+        static uint32_t counter(unsigned size, unsigned orientation) noexcept {
+            return Details::corner_cycle_counter[size][orientation];
+        }
+        static int cycles(uint32_t counter) noexcept {
+            return Details::corner_cycles_from_counter(counter);
+        }
+    };
+
+    struct EdgeCycles {
+        static uint8_t twist(uint8_t item, uint8_t transform) noexcept {
+            return Details::twist_edge(item, transform);
+        }
+        static uint32_t counter(unsigned size, unsigned flip) noexcept {
+            return Details::edge_cycle_counter[size][flip & 1];
+        }
+        static int cycles(uint32_t counter) noexcept {
+            return Details::edge_cycles_from_counter(counter);
+        }
+    };
+
+    // Cycle structure of a state, so that the cycle counts after twisting a case with a small support before it
+    // only need to rebuild the cycles passing through the affected slots.
+    // path[x][y] is the distance from slot x forward to slot y in their common cycle in the high byte
+    // and the orientation sum along the way in the low byte, or 0xffff if they are in different cycles.
+    template<class Cycles, size_t N> class CycleDecomposition {
+    private:
+        const uint8_t* state;
+        uint8_t inverse[N];
+        uint8_t leader[N];
+        uint8_t size[N];
+        uint8_t sum[N];
+        uint16_t path[N][N];
+        uint32_t counter;
+    public:
+        explicit CycleDecomposition(const uint8_t* state) noexcept: state(state), counter(0) {
+            std::memset(this->path, 0xff, sizeof(this->path));
+            unsigned visited_mask = 0;
+            for (unsigned x = 0; x < N; ++x) {
+                this->inverse[state[x] & 0xf] = x;
+                if (visited_mask & (1 << x)) {
+                    continue;
+                }
+                uint8_t cycle[N];
+                unsigned size = 0;
+                unsigned sum = 0;
+                unsigned y = x;
+                do {
+                    visited_mask |= 1 << y;
+                    this->leader[y] = x;
+                    cycle[size++] = y;
+                    sum += state[y] >> 4;
+                    y = state[y] & 0xf;
+                } while (y != x);
+                this->size[x] = size;
+                this->sum[x] = sum;
+                this->counter += Cycles::counter(size, sum);
+                for (unsigned i = 0; i < size; ++i) {
+                    unsigned partial_sum = 0;
+                    for (unsigned distance = 0; distance < size; ++distance) {
+                        unsigned z = cycle[(i + distance) % size];
+                        this->path[cycle[i]][z] = distance << 8 | partial_sum;
+                        partial_sum += state[z] >> 4;
+                    }
+                }
+            }
+        }
+    public:
+        int cycles(size_t count, const uint8_t* position, const uint8_t* item) const noexcept {
+            uint8_t slot[N];
+            uint8_t leader[N];
+            uint16_t weight[N];
+            uint8_t next[N];
+            uint32_t counter = this->counter;
+            for (size_t i = 0; i < count; ++i) {
+                slot[i] = this->inverse[position[i]];
+                leader[i] = this->leader[slot[i]];
+                bool first = true;
+                for (size_t j = 0; j < i; ++j) {
+                    first &= leader[j] != leader[i];
+                }
+                counter -= Cycles::counter(this->size[leader[i]], this->sum[leader[i]]) & -static_cast<uint32_t>(first);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                const uint16_t* path = this->path[item[i] & 0xf];
+                unsigned best = 0xffff;
+                next[i] = 0;
+                for (size_t j = 0; j < count; ++j) {
+                    unsigned candidate = path[slot[j]];
+                    next[i] = candidate < best ? j : next[i];
+                    best = candidate < best ? candidate : best;
+                }
+                weight[i] = best + (1 << 8) + (Cycles::twist(this->state[slot[i]], item[i]) >> 4);
+            }
+            // the new cycles through the affected slots have at most three elements
+            for (size_t i = 0; i < count; ++i) {
+                size_t next1 = next[i];
+                size_t next2 = next[next1];
+                unsigned cycle_weight = weight[i]
+                    + (next1 != i ? weight[next1] : 0)
+                    + (next2 != i ? weight[next2] : 0);
+                bool first = i <= next1 && i <= next2;
+                counter += Cycles::counter(cycle_weight >> 8, cycle_weight & 0xff) & -static_cast<uint32_t>(first);
+            }
+            return Cycles::cycles(counter);
+        }
+    };
+};
+
+
+CubeBatch::CubeBatch(const std::vector<Cube>& cubes):
+    count(cubes.size()),
+    stride((cubes.size() + block_size - 1) / block_size * block_size),
+    corner(8 * this->stride),
+    edge(12 * this->stride),
+    corner_support_index(cubes.size()),
+    edge_support_index(cubes.size()) {
+    std::vector<Support> corner_support(this->count, Support {0, {}, {}});
+    std::vector<Support> edge_support(this->count, Support {0, {}, {}});
+    for (size_t i = 0; i < 8; ++i) {
+        uint8_t* lane = &this->corner[i * this->stride];
+        std::fill(lane + this->count, lane + this->stride, i);
+        for (size_t index = 0; index < this->count; ++index) {
+            uint8_t item = lane[index] = cubes[index].corner[i];
+            Support& support = corner_support[index];
+            if (item != i && support.size++ < CubeBatch::max_support_size) {
+                support.position[support.size - 1] = i;
+                support.item[support.size - 1] = item;
+            }
+        }
+    }
+    for (size_t i = 0; i < 12; ++i) {
+        uint8_t* lane = &this->edge[i * this->stride];
+        std::fill(lane + this->count, lane + this->stride, i);
+        for (size_t index = 0; index < this->count; ++index) {
+            uint8_t item = lane[index] = cubes[index].edge[i];
+            Support& support = edge_support[index];
+            if (item != i && support.size++ < CubeBatch::max_support_size) {
+                support.position[support.size - 1] = i;
+                support.item[support.size - 1] = item;
+            }
+        }
+    }
+
+    auto deduplicate = [this](
+        const std::vector<Support>& supports,
+        std::vector<Support>& unique_supports,
+        std::vector<uint16_t>& support_index
+    ) {
+        std::unordered_map<uint64_t, uint16_t> index_map;
+        for (size_t index = 0; index < this->count; ++index) {
+            const Support& support = supports[index];
+            if (support.size > CubeBatch::max_support_size) {
+                support_index[index] = CubeBatch::no_support;
+                continue;
+            }
+            uint64_t key = 0;
+            std::memcpy(&key, &support, sizeof(Support));
+            auto [iter, inserted] = index_map.try_emplace(key, unique_supports.size());
+            if (inserted) {
+                unique_supports.push_back(support);
+            }
+            support_index[index] = iter->second;
+        }
+    };
+    deduplicate(corner_support, this->corner_support, this->corner_support_index);
+    deduplicate(edge_support, this->edge_support, this->edge_support_index);
+}
+
+
+void CubeBatch::twist_before(const Cube& cube, Result& result, std::byte flags) const {
+    if (static_cast<bool>(flags & CubeTwist::corners)) {
+        bool compose = false;
+        for (size_t index = 0; index < this->count; ++index) {
+            compose |= static_cast<bool>(result.flags[index] & CubeTwist::corners)
+                && this->corner_support_index[index] == CubeBatch::no_support;
+        }
+        if (compose) {
+            result.corner.resize(8 * this->stride);
+            for (size_t i = 0; i < 8; ++i) {
+                uint8_t orientation = cube.corner[i] & 0x30;
+                const uint8_t* from = &this->corner[(cube.corner[i] & 0xf) * this->stride];
+                uint8_t* to = &result.corner[i * this->stride];
+                for (size_t begin = 0; begin < this->stride; begin += block_size) {
+                    uint8_t block[block_size];
+                    std::memcpy(block, from + begin, block_size);
+                    for (size_t j = 0; j < block_size; ++j) {
+                        uint8_t sum = block[j] + orientation;
+                        block[j] = std::min<uint8_t>(sum, sum - 0x30);
+                    }
+                    std::memcpy(to + begin, block, block_size);
+                }
+            }
+        }
+        CycleDecomposition<CornerCycles, 8> decomposition(cube.corner);
+        result.corner_cycles.resize(this->count);
+        result.corner_support_cycles.assign(this->corner_support.size(), -1);
+        for (size_t index = 0; index < this->count; ++index) {
+            if (!static_cast<bool>(result.flags[index] & CubeTwist::corners)) {
+                continue;
+            }
+            uint16_t support_index = this->corner_support_index[index];
+            if (support_index != CubeBatch::no_support) {
+                int& cycles = result.corner_support_cycles[support_index];
+                if (cycles < 0) {
+                    const Support& support = this->corner_support[support_index];
+                    cycles = decomposition.cycles(support.size, support.position, support.item);
+                }
+                result.corner_cycles[index] = cycles;
+            } else {
+                uint8_t corner[8];
+                for (size_t i = 0; i < 8; ++i) {
+                    corner[i] = result.corner[i * this->stride + index];
+                }
+                result.corner_cycles[index] = Details::cube_kernels->corner_cycles(corner);
+            }
+        }
+    }
+    if (static_cast<bool>(flags & CubeTwist::edges)) {
+        bool compose = false;
+        for (size_t index = 0; index < this->count; ++index) {
+            compose |= static_cast<bool>(result.flags[index] & CubeTwist::edges)
+                && this->edge_support_index[index] == CubeBatch::no_support;
+        }
+        if (compose) {
+            result.edge.resize(12 * this->stride);
+            for (size_t i = 0; i < 12; ++i) {
+                uint8_t flip = cube.edge[i] & 0x10;
+                const uint8_t* from = &this->edge[(cube.edge[i] & 0xf) * this->stride];
+                uint8_t* to = &result.edge[i * this->stride];
+                for (size_t begin = 0; begin < this->stride; begin += block_size) {
+                    uint8_t block[block_size];
+                    std::memcpy(block, from + begin, block_size);
+                    for (size_t j = 0; j < block_size; ++j) {
+                        block[j] ^= flip;
+                    }
+                    std::memcpy(to + begin, block, block_size);
+                }
+            }
+        }
+        CycleDecomposition<EdgeCycles, 12> decomposition(cube.edge);
+        result.edge_cycles.resize(this->count);
+        result.edge_support_cycles.assign(this->edge_support.size(), -1);
+        for (size_t index = 0; index < this->count; ++index) {
+            if (!static_cast<bool>(result.flags[index] & CubeTwist::edges)) {
+                continue;
+            }
+            uint16_t support_index = this->edge_support_index[index];
+            if (support_index != CubeBatch::no_support) {
+                int& cycles = result.edge_support_cycles[support_index];
+                if (cycles < 0) {
+                    const Support& support = this->edge_support[support_index];
+                    cycles = decomposition.cycles(support.size, support.position, support.item);
+                }
+                result.edge_cycles[index] = cycles;
+            } else {
+                alignas(16) uint8_t edge[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+                for (size_t i = 0; i < 12; ++i) {
+                    edge[i] = result.edge[i * this->stride + index];
+                }
+                result.edge_cycles[index] = Details::cube_kernels->edge_cycles(edge);
+            }
+        }
+    }
+}
@@ -1,51 +1,68 @@
 #include <cstddef>
-#include <cstring>
+#include <cstdint>
 #include <array>
 #include <insertionfinder/cube.hpp>
+#include "kernels.hpp"
+#include "utils.hpp"
 using std::size_t;
 using InsertionFinder::Cube;
+namespace Details = InsertionFinder::Details;
 
 
 namespace {
-    constexpr unsigned rotation_corner_table[4][8] = {
-        {0, 3, 6, 9, 12, 15, 18, 21},
-        {14, 1, 11, 22, 16, 5, 7, 20},
-        {9, 0, 3, 6, 21, 12, 15, 18},
-        {10, 8, 19, 23, 2, 4, 17, 13}
+    constexpr std::uint8_t rotation_corner_table[4][8] = {
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07},
+        {0x24, 0x10, 0x23, 0x17, 0x15, 0x21, 0x12, 0x26},
+        {0x03, 0x00, 0x01, 0x02, 0x07, 0x04, 0x05, 0x06},
+        {0x13, 0x22, 0x16, 0x27, 0x20, 0x11, 0x25, 0x14}
     };
 
-    constexpr unsigned rotation_edge_table[4][12] = {
-        {0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22},
-        {9, 16, 1, 22, 13, 18, 5, 20, 10, 2, 6, 14},
-        {6, 0, 2, 4, 14, 8, 10, 12, 23, 17, 19, 21},
-        {23, 7, 21, 15, 17, 3, 19, 11, 1, 5, 13, 9}
+    constexpr std::uint8_t rotation_edge_table[4][12] = {
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b},
+        {0x14, 0x08, 0x10, 0x0b, 0x16, 0x09, 0x12, 0x0a, 0x05, 0x01, 0x03, 0x07},
+        {0x03, 0x00, 0x01, 0x02, 0x07, 0x04, 0x05, 0x06, 0x1b, 0x18, 0x19, 0x1a},
+        {0x1b, 0x13, 0x1a, 0x17, 0x18, 0x11, 0x19, 0x15, 0x10, 0x12, 0x16, 0x14}
     };
 }
 
 
-std::array<Cube, 24> Cube::generate_rotation_cube_table() noexcept {
+constexpr std::array<Cube, 24> Cube::generate_rotation_cube_table() noexcept {
+    auto twist = [](Cube& cube, const Cube& rhs) {
+        Cube result = cube;
+        for (size_t i = 0; i < 8; ++i) {
+            result.corner[i] = Details::twist_corner(cube.corner[i], rhs.corner[cube.corner[i] & 0xf]);
+        }
+        for (size_t i = 0; i < 12; ++i) {
+            result.edge[i] = Details::twist_edge(cube.edge[i], rhs.edge[cube.edge[i] & 0xf]);
+        }
+        cube = result;
+    };
     std::array<Cube, 24> rotation_cube;
     Cube basic_rotation_cube[4];
     for (size_t i = 0; i < 4; ++i) {
-        std::memcpy(basic_rotation_cube[i].corner, rotation_corner_table[i], 8 * sizeof(unsigned));
-        std::memcpy(basic_rotation_cube[i].edge, rotation_edge_table[i], 12 * sizeof(unsigned));
+        for (size_t j = 0; j < 8; ++j) {
+            basic_rotation_cube[i].corner[j] = rotation_corner_table[i][j];
+        }
+        for (size_t j = 0; j < 12; ++j) {
+            basic_rotation_cube[i].edge[j] = rotation_edge_table[i][j];
+        }
     }
     for (size_t front = 0; front < 4; ++front) {
-        rotation_cube[front | 4].twist(basic_rotation_cube[1]);
-        rotation_cube[front | 8].twist(basic_rotation_cube[1]);
-        rotation_cube[front | 8].twist(basic_rotation_cube[1]);
-        rotation_cube[front | 12].twist(basic_rotation_cube[1]);
-        rotation_cube[front | 12].twist(basic_rotation_cube[1]);
-        rotation_cube[front | 12].twist(basic_rotation_cube[1]);
-        rotation_cube[front | 16].twist(basic_rotation_cube[3]);
-        rotation_cube[front | 20].twist(basic_rotation_cube[3]);
-        rotation_cube[front | 20].twist(basic_rotation_cube[3]);
-        rotation_cube[front | 20].twist(basic_rotation_cube[3]);
+        twist(rotation_cube[front | 4], basic_rotation_cube[1]);
+        twist(rotation_cube[front | 8], basic_rotation_cube[1]);
+        twist(rotation_cube[front | 8], basic_rotation_cube[1]);
+        twist(rotation_cube[front | 12], basic_rotation_cube[1]);
+        twist(rotation_cube[front | 12], basic_rotation_cube[1]);
+        twist(rotation_cube[front | 12], basic_rotation_cube[1]);
+        twist(rotation_cube[front | 16], basic_rotation_cube[3]);
+        twist(rotation_cube[front | 20], basic_rotation_cube[3]);
+        twist(rotation_cube[front | 20], basic_rotation_cube[3]);
+        twist(rotation_cube[front | 20], basic_rotation_cube[3]);
     }
     for (size_t top = 0; top < 6; ++top) {
         for (size_t front = 1; front < 4; ++front) {
             for (size_t i = 0; i < front; ++i) {
-                rotation_cube[top << 2 | front].twist(basic_rotation_cube[2]);
+                twist(rotation_cube[top << 2 | front], basic_rotation_cube[2]);
             }
         }
     }
@@ -55,36 +72,75 @@ std::array<Cube, 24> Cube::generate_rotation_cube_table() noexcept {
     return rotation_cube;
 }
 
-const std::array<Cube, 24> Cube::rotation_cube = Cube::generate_rotation_cube_table();
+constexpr std::array<Cube, 24> Cube::rotation_cube = Cube::generate_rotation_cube_table();
 
 
 Cube Cube::best_placement() const noexcept {
+    // whole cube rotations permute the corners evenly, so the parity is the same for every placement
+    static_assert([] {
+        for (const Cube& cube: Cube::rotation_cube) {
+            unsigned visited_mask = 0;
+            bool parity = false;
+            for (unsigned x = 0; x < 8; ++x) {
+                if ((visited_mask & (1 << x)) == 0) {
+                    parity = !parity;
+                    for (unsigned y = x; (visited_mask & (1 << y)) == 0; y = cube.corner[y] & 0xf) {
+                        visited_mask |= 1 << y;
+                    }
+                }
+            }
+            if (parity) {
+                return false;
+            }
+        }
+        return true;
+    }());
+
+    static constexpr Details::PlacementTable placement_table = [] {
+        Details::PlacementTable table {};
+        for (size_t placement = 0; placement < 24; ++placement) {
+            for (size_t i = 0; i < 8; ++i) {
+                table.corner[placement][i] = Cube::rotation_cube[placement].corner[i];
+            }
+            for (size_t i = 0; i < 16; ++i) {
+                table.edge[placement][i] = Cube::rotation_cube[placement].edge[i];
+            }
+        }
+        return table;
+    }();
+
     Cube original_cube = *this;
     original_cube.rotate(this->_placement.inverse());
-    int best_cycles = original_cube.corner_cycles() + original_cube.edge_cycles() + original_cube.has_parity();
+    bool parity = original_cube.has_parity();
+    int best_cycles = original_cube.corner_cycles() + original_cube.edge_cycles() + parity;
     if (best_cycles <= 4) {
         return original_cube;
     }
 
-    Cube best_cube = original_cube;
+    int corner_cycles[24];
+    int edge_cycles[24];
+    Details::cube_kernels->placement_cycles(
+        original_cube.corner, original_cube.edge, placement_table,
+        corner_cycles, edge_cycles
+    );
+    size_t best_rotation = 0;
     for (size_t rotation: {
         2, 8, 10,
         5, 7, 13, 15, 17, 19, 21, 23,
         1, 3, 4, 12, 16, 20,
         6, 9, 11, 14, 18, 22
     }) {
-        Cube cube = original_cube * Cube::rotation_cube[rotation];
-        int cycles = cube.corner_cycles() + cube.edge_cycles();
+        int cycles = corner_cycles[rotation] + edge_cycles[rotation];
         if (Cube::center_cycles[rotation] <= 1) {
-            cycles += cube.has_parity();
+            cycles += parity;
         }
         if (cycles <= 4) {
-            return cube;
+            return original_cube * Cube::rotation_cube[rotation];
         }
         if (cycles + Cube::center_cycles[rotation] < best_cycles) {
-            best_cube = cube;
+            best_rotation = rotation;
             best_cycles = cycles + Cube::center_cycles[rotation];
         }
     }
-    return best_cube;
+    return best_rotation ? original_cube * Cube::rotation_cube[best_rotation] : original_cube;
 }
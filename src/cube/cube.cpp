@@ -8,21 +8,19 @@
 #include <ostream>
 #include <vector>
 #include <insertionfinder/cube.hpp>
+#include "kernels.hpp"
+#include "utils.hpp"
 using std::size_t;
 using std::uint64_t;
+using std::uint8_t;
 using InsertionFinder::Cube;
 using InsertionFinder::CubeStreamError;
+namespace Details = InsertionFinder::Details;
 
 
 void Cube::save_to(std::ostream& out) const {
     char data[21];
-    for (size_t i = 0; i < 8; ++i) {
-        data[i] = this->corner[i];
-    }
-    for (size_t i = 0; i < 12; ++i) {
-        data[i + 8] = this->edge[i];
-    }
-    data[20] = this->_placement;
+    this->save_to(data);
     out.write(data, 21);
 }
 
@@ -32,42 +30,52 @@ void Cube::read_from(std::istream& in) {
     if (in.gcount() != 21) {
         throw CubeStreamError();
     }
+    this->read_from(data);
+}
+
+void Cube::save_to(char data[21]) const noexcept {
     for (size_t i = 0; i < 8; ++i) {
-        this->corner[i] = data[i];
+        data[i] = Details::corner_value(this->corner[i]);
     }
     for (size_t i = 0; i < 12; ++i) {
-        this->edge[i] = data[i + 8];
+        data[i + 8] = Details::edge_value(this->edge[i]);
+    }
+    data[20] = this->_placement;
+}
+
+void Cube::read_from(const char data[21]) noexcept {
+    for (size_t i = 0; i < 8; ++i) {
+        this->corner[i] = Details::corner_item(data[i]);
+    }
+    for (size_t i = 0; i < 12; ++i) {
+        this->edge[i] = Details::edge_item(data[i + 8]);
     }
     this->_placement = data[20];
 }
 
 
-void Cube::inverse() noexcept {
-    unsigned corner[8];
-    unsigned edge[12];
-    for (unsigned i = 0; i < 8; ++i) {
-        unsigned item = this->corner[i];
-        corner[item / 3] = i * 3 + (24 - item) % 3;
+int Cube::compare(const Cube& lhs, const Cube& rhs) noexcept {
+    for (size_t i = 0; i < 8; ++i) {
+        if (int x = Details::corner_value(lhs.corner[i]) - Details::corner_value(rhs.corner[i])) {
+            return x;
+        }
     }
-    std::memcpy(this->corner, corner, 8 * sizeof(unsigned));
-    for (unsigned i = 0; i < 12; ++i) {
-        unsigned item = this->edge[i];
-        edge[item >> 1] = i << 1 | (item & 1);
+    for (size_t i = 0; i < 12; ++i) {
+        if (int x = Details::edge_value(lhs.edge[i]) - Details::edge_value(rhs.edge[i])) {
+            return x;
+        }
     }
-    std::memcpy(this->edge, edge, 12 * sizeof(unsigned));
-    this->_placement = this->_placement.inverse();
+    return lhs._placement - rhs._placement;
+}
+
+
+void Cube::inverse() noexcept {
+    *this = Cube::inverse(*this);
 }
 
 Cube Cube::inverse(const Cube& cube) noexcept {
     Cube result(Cube::raw_construct);
-    for (unsigned i = 0; i < 8; ++i) {
-        unsigned item = cube.corner[i];
-        result.corner[item / 3] = i * 3 + (24 - item) % 3;
-    }
-    for (unsigned i = 0; i < 12; ++i) {
-        unsigned item = cube.edge[i];
-        result.edge[item >> 1] = i << 1 | (item & 1);
-    }
+    Details::cube_kernels->inverse(cube.corner, cube.edge, result.corner, result.edge);
     result._placement = cube._placement.inverse();
     return result;
 }
@@ -82,36 +90,19 @@ uint64_t Cube::mask() const noexcept {
         0x0f, 0x3f, 0x3f, 0x3f,
         0x0f, 0x3f, 0x3f, 0x3f
     };
-    uint64_t mask = 0;
-    for (unsigned i = 0; i < 8; ++i) {
-        if (this->corner[i] != i * 3) {
-            mask |= UINT64_C(1) << i;
-            if (this->corner[i] / 3 == i) {
-                mask |= UINT64_C(1) << (i + 32);
-            }
-        }
-    }
-    for (unsigned i = 0; i < 12; ++i) {
-        if (this->edge[i] != i << 1) {
-            mask |= UINT64_C(1) << (i + 8);
-            if (this->edge[i] >> 1 == i) {
-                mask |= UINT64_C(1) << (i + 40);
-            }
-        }
-    }
+    uint64_t mask = Details::cube_kernels->mask(this->corner, this->edge);
     mask |= center_mask[this->_placement] << 20;
     return mask;
 }
 
+const char* Cube::kernel_name() noexcept {
+    return Details::cube_kernels->name;
+}
 
-size_t std::hash<Cube>::operator()(const Cube& cube) const noexcept {
-    size_t result = 0;
-    for (size_t i = 0; i < 8; ++i) {
-        result = result * 31 + cube.corner[i];
-    }
-    for (size_t i = 0; i < 12; ++i) {
-        result = result * 31 + cube.edge[i];
+bool Cube::select_kernels(const char* name) noexcept {
+    if (const Details::CubeKernels* kernels = Details::find_cube_kernels(name)) {
+        Details::cube_kernels = kernels;
+        return true;
     }
-    result = result * 31 + cube._placement;
-    return result;
+    return false;
 }
@@ -1,14 +1,16 @@
 #include <cstddef>
+#include <cstdint>
 #include <array>
-#include <optional>
-#include <insertionfinder/algorithm.hpp>
 #include <insertionfinder/cube.hpp>
 #include <insertionfinder/twist.hpp>
+#include "kernels.hpp"
+#include "utils.hpp"
 using std::size_t;
-using InsertionFinder::Algorithm;
+using std::int16_t;
+using std::uint8_t;
 using InsertionFinder::Cube;
 using InsertionFinder::Twist;
-namespace CubeTwist = InsertionFinder::CubeTwist;
+namespace Details = InsertionFinder::Details;
 
 
 bool Cube::has_parity() const noexcept {
@@ -20,7 +22,7 @@ bool Cube::has_parity() const noexcept {
             unsigned y = x;
             do {
                 visited_mask |= 1 << y;
-                y = this->corner[y] / 3;
+                y = this->corner[y] & 0xf;
             } while (y != x);
         }
     }
@@ -29,204 +31,139 @@ bool Cube::has_parity() const noexcept {
 
 
 int Cube::corner_cycles() const noexcept {
-    unsigned visited_mask = 0;
-    int self_orientation[3] = {0, 0, 0};
-    int even_permutation[3] = {0, 0, 0};
-    int odd_permutation[3] = {0, 0, 0};
-    int cycles = 0;
-    bool parity = false;
+    return Details::cube_kernels->corner_cycles(this->corner);
+}
 
-    for (unsigned x = 0; x < 8; ++x) {
-        if ((visited_mask & (1 << x)) == 0) {
-            int length = -1;
-            unsigned orientation = 0;
-            unsigned y = x;
-            do {
-                visited_mask |= 1 << y;
-                ++length;
-                orientation += this->corner[y];
-                y = this->corner[y] / 3;
-            } while (y != x);
-            cycles += length >> 1;
-            orientation %= 3;
-            if (length == 0 && orientation) {
-                ++self_orientation[orientation];
-            } else if ((length & 1) == 0 && orientation) {
-                ++even_permutation[orientation];
-            } else if (length & 1) {
-                parity = !parity;
-                ++cycles;
-                ++odd_permutation[orientation];
+int Cube::edge_cycles() const noexcept {
+    return Details::cube_kernels->edge_cycles(this->edge);
+}
+
+
+namespace {
+    constexpr bool corner_cycle_pieces(unsigned index, uint8_t* corner) {
+        unsigned x = index / 24 / 24;
+        unsigned y = index / 24 % 24;
+        unsigned z = index % 24;
+        if (x < y / 3 && x < z / 3 && y / 3 != z / 3) {
+            for (unsigned i = 0; i < 8; ++i) {
+                corner[i] = i;
             }
+            corner[x] = Details::corner_item(y);
+            corner[y / 3] = Details::corner_item(z);
+            corner[z / 3] = Details::corner_item(x * 3 + (48 - y - z) % 3);
+            return true;
+        } else {
+            return false;
         }
     }
 
-    if (parity) {
-        --cycles;
-        if (odd_permutation[0]) {
-            --odd_permutation[0];
-        } else if (odd_permutation[1] < odd_permutation[2]) {
-            --odd_permutation[2];
-            ++even_permutation[2];
+    constexpr bool edge_cycle_pieces(unsigned index, uint8_t* edge) {
+        unsigned x = index / 24 / 24;
+        unsigned y = index / 24 % 24;
+        unsigned z = index % 24;
+        if (x < y >> 1 && x < z >> 1 && y >> 1 != z >> 1) {
+            for (unsigned i = 0; i < 12; ++i) {
+                edge[i] = i;
+            }
+            edge[x] = Details::edge_item(y);
+            edge[y >> 1] = Details::edge_item(z);
+            edge[z >> 1] = Details::edge_item(x << 1 | ((y ^ z) & 1));
+            return true;
         } else {
-            --odd_permutation[1];
-            ++even_permutation[1];
+            return false;
         }
     }
 
-    if (odd_permutation[1] < odd_permutation[2]) {
-        even_permutation[2] += odd_permutation[0] & 1;
-        even_permutation[1] += (odd_permutation[2] - odd_permutation[1]) >> 1;
-    } else {
-        even_permutation[1] += odd_permutation[0] & 1;
-        even_permutation[2] += (odd_permutation[1] - odd_permutation[2]) >> 1;
-    }
-
-    int x = self_orientation[1] + even_permutation[1];
-    int y = self_orientation[2] + even_permutation[2];
-    cycles += (x / 3 + y / 3) << 1;
-    int twists = x % 3;
-    return cycles + twists + (even_permutation[1] + even_permutation[2] < twists);
-}
-
-
-int Cube::edge_cycles() const noexcept {
-    unsigned visited_mask = 0;
-    int self_flip = 0;
-    int even_flip = 0;
-    int odd_flip = 0;
-    int cycles = 0;
-    bool parity = false;
-
-    for (unsigned x = 0; x < 12; ++x) {
-        if ((visited_mask & (1 << x)) == 0) {
-            int length = -1;
-            bool flip = false;
-            unsigned y = x;
-            do {
-                visited_mask |= 1 << y;
-                ++length;
-                flip ^= this->edge[y] & 1;
-                y = this->edge[y] >> 1;
-            } while (y != x);
-            cycles += length >> 1;
-            if (length & 1) {
-                parity = !parity;
-                ++cycles;
-            }
-            if (flip) {
-                if (length == 0) {
-                    ++self_flip;
-                } else if (length & 1) {
-                    odd_flip ^= 1;
-                } else {
-                    ++even_flip;
-                }
+    constexpr int corner_cycle_index(const uint8_t* corner) {
+        for (unsigned i = 0; i < 8; ++i) {
+            unsigned j = Details::corner_value(corner[i]);
+            if (i != j / 3) {
+                unsigned k = Details::corner_value(corner[j / 3]);
+                return k / 3 == i ? -1 : i * 24 * 24 + j * 24 + k;
             }
         }
+        return -1;
     }
 
-    even_flip += odd_flip;
-    if (self_flip < even_flip) {
-        cycles += (self_flip + even_flip) >> 1;
-    } else {
-        static constexpr int flip_cycles[7] = {0, 2, 3, 5, 6, 8, 9};
-        cycles += even_flip + flip_cycles[(self_flip - even_flip) >> 1];
+    constexpr int edge_cycle_index(const uint8_t* edge) {
+        for (unsigned i = 0; i < 12; ++i) {
+            unsigned j = Details::edge_value(edge[i]);
+            if (i != j >> 1) {
+                unsigned k = Details::edge_value(edge[j >> 1]);
+                return k >> 1 == i ? -1 : i * 24 * 24 + j * 24 + k;
+            }
+        }
+        return -1;
     }
 
-    return cycles - parity;
-}
-
-
-std::optional<Cube> Cube::corner_cycle_cube(unsigned index) {
-    unsigned x = index / 24 / 24;
-    unsigned y = index / 24 % 24;
-    unsigned z = index % 24;
-    if (x < y / 3 && x < z / 3 && y / 3 != z / 3) {
-        Cube cube;
-        cube.corner[x] = y;
-        cube.corner[y / 3] = z;
-        cube.corner[z / 3] = x * 3 + (48 - y - z) % 3;
-        return cube;
-    } else {
-        return std::nullopt;
+    constexpr std::array<std::array<int16_t, 24>, 6 * 24 * 24> generate_corner_cycle_transform_table() {
+        std::array<std::array<int16_t, 24>, 6 * 24 * 24> corner_cycle_transform {};
+        for (unsigned i = 0; i < 6 * 24 * 24; ++i) {
+            uint8_t corner[8] = {};
+            if (corner_cycle_pieces(i, corner)) {
+                for (size_t j = 0; j < 24; ++j) {
+                    if (j & 3) {
+                        const uint8_t* twist = Details::corner_twist_table[j];
+                        const uint8_t* inverse_twist = Details::corner_twist_table[Twist::inverse(j)];
+                        uint8_t new_corner[8] = {};
+                        for (unsigned k = 0; k < 8; ++k) {
+                            new_corner[k] = k;
+                        }
+                        for (unsigned k = 0; k < 8; ++k) {
+                            if (corner[k] != k) {
+                                unsigned position = twist[k] & 0xf;
+                                uint8_t item = Details::twist_corner(inverse_twist[position], corner[k]);
+                                new_corner[position] = Details::twist_corner(item, twist[item & 0xf]);
+                            }
+                        }
+                        corner_cycle_transform[i][j] = corner_cycle_index(new_corner);
+                    }
+                }
+            }
+        }
+        return corner_cycle_transform;
     }
-}
 
-std::optional<Cube> Cube::edge_cycle_cube(unsigned index) {
-    unsigned x = index / 24 / 24;
-    unsigned y = index / 24 % 24;
-    unsigned z = index % 24;
-    if (x < y >> 1 && x < z >> 1 && y >> 1 != z >> 1) {
-        Cube cube;
-        cube.edge[x] = y;
-        cube.edge[y >> 1] = z;
-        cube.edge[z >> 1] = x << 1 | ((y ^ z) & 1);
-        return cube;
-    } else {
-        return std::nullopt;
+    constexpr std::array<std::array<int16_t, 24>, 10 * 24 * 24> generate_edge_cycle_transform_table() {
+        std::array<std::array<int16_t, 24>, 10 * 24 * 24> edge_cycle_transform {};
+        for (unsigned i = 0; i < 10 * 24 * 24; ++i) {
+            uint8_t edge[12] = {};
+            if (edge_cycle_pieces(i, edge)) {
+                for (size_t j = 0; j < 24; ++j) {
+                    if (j & 3) {
+                        const uint8_t* twist = Details::edge_twist_table[j];
+                        const uint8_t* inverse_twist = Details::edge_twist_table[Twist::inverse(j)];
+                        uint8_t new_edge[12] = {};
+                        for (unsigned k = 0; k < 12; ++k) {
+                            new_edge[k] = k;
+                        }
+                        for (unsigned k = 0; k < 12; ++k) {
+                            if (edge[k] != k) {
+                                unsigned position = twist[k] & 0xf;
+                                uint8_t item = Details::twist_edge(inverse_twist[position], edge[k]);
+                                new_edge[position] = Details::twist_edge(item, twist[item & 0xf]);
+                            }
+                        }
+                        edge_cycle_transform[i][j] = edge_cycle_index(new_edge);
+                    }
+                }
+            }
+        }
+        return edge_cycle_transform;
     }
-}
+};
 
 
 int Cube::corner_cycle_index() const noexcept {
-    for (unsigned i = 0; i < 8; ++i) {
-        unsigned j = this->corner[i];
-        if (i != j / 3) {
-            unsigned k = this->corner[j / 3];
-            return k / 3 == i ? -1 : i * 24 * 24 + j * 24 + k;
-        }
-    }
-    return -1;
+    return ::corner_cycle_index(this->corner);
 }
 
 int Cube::edge_cycle_index() const noexcept {
-    for (unsigned i = 0; i < 12; ++i) {
-        unsigned j = this->edge[i];
-        if (i != j >> 1) {
-            unsigned k = this->edge[j >> 1];
-            return k >> 1 == i ? -1 : i * 24 * 24 + j * 24 + k;
-        }
-    }
-    return -1;
+    return ::edge_cycle_index(this->edge);
 }
 
 
-const std::vector<std::array<int, 24>> Cube::corner_cycle_transform = generate_corner_cycle_transform_table();
-const std::vector<std::array<int, 24>> Cube::edge_cycle_transform = generate_edge_cycle_transform_table();
-
-std::vector<std::array<int, 24>> Cube::generate_corner_cycle_transform_table() {
-    std::vector<std::array<int, 24>> corner_cycle_transform(6 * 24 * 24);
-    for (size_t i = 0; i < 6 * 24 * 24; ++i) {
-        auto& table = corner_cycle_transform[i];
-        if (auto cube = Cube::corner_cycle_cube(i)) {
-            for (size_t j = 0; j < 24; ++j) {
-                if (j & 3) {
-                    Cube new_cube = *cube;
-                    new_cube.twist_before(Twist::inverse(j), CubeTwist::corners);
-                    new_cube.twist(j, CubeTwist::corners);
-                    table[j] = new_cube.corner_cycle_index();
-                }
-            }
-        }
-    }
-    return corner_cycle_transform;
-}
-
-std::vector<std::array<int, 24>> Cube::generate_edge_cycle_transform_table() {
-    std::vector<std::array<int, 24>> edge_cycle_transform(10 * 24 * 24);
-    for (size_t i = 0; i < 10 * 24 * 24; ++i) {
-        auto& table = edge_cycle_transform[i];
-        if (auto cube = Cube::edge_cycle_cube(i)) {
-            for (size_t j = 0; j < 24; ++j) {
-                if (j & 3) {
-                    Cube new_cube = *cube;
-                    new_cube.twist_before(Twist::inverse(j), CubeTwist::edges);
-                    new_cube.twist(j, CubeTwist::edges);
-                    table[j] = new_cube.edge_cycle_index();
-                }
-            }
-        }
-    }
-    return edge_cycle_transform;
-}
+constexpr std::array<std::array<int16_t, 24>, 6 * 24 * 24> Cube::corner_cycle_transform =
+    generate_corner_cycle_transform_table();
+constexpr std::array<std::array<int16_t, 24>, 10 * 24 * 24> Cube::edge_cycle_transform =
+    generate_edge_cycle_transform_table();
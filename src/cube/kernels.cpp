@@ -0,0 +1,619 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "kernels.hpp"
+#include "utils.hpp"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INSERTIONFINDER_X86_KERNELS
+#include <immintrin.h>
+#endif
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+using InsertionFinder::Details::CubeKernels;
+using InsertionFinder::Details::PlacementTable;
+using InsertionFinder::Details::TwistTable;
+using InsertionFinder::Details::corner_cycle_counter;
+using InsertionFinder::Details::corner_cycles_from_counter;
+using InsertionFinder::Details::edge_cycle_counter;
+using InsertionFinder::Details::edge_cycles_from_counter;
+namespace CubeTwist = InsertionFinder::CubeTwist;
+namespace Details = InsertionFinder::Details;
+
+
+namespace {
+    constexpr std::byte corners_and_edges = CubeTwist::corners | CubeTwist::edges;
+
+    template<std::byte flags, auto twist, auto twist_corners, auto twist_edges>
+    void twist_move(
+        const uint8_t* corner, const uint8_t* edge, const TwistTable& table,
+        uint8_t* result_corner, uint8_t* result_edge
+    ) noexcept {
+        if constexpr (flags == corners_and_edges) {
+            twist(corner, edge, table.corner, table.edge, result_corner, result_edge);
+        } else if constexpr (flags == CubeTwist::corners) {
+            twist_corners(corner, table.corner, result_corner);
+        } else if constexpr (flags == CubeTwist::edges) {
+            twist_edges(edge, table.edge, result_edge);
+        }
+    }
+
+    template<std::byte flags, auto twist, auto twist_corners, auto twist_edges>
+    void twist_move_before(
+        const uint8_t* corner, const uint8_t* edge, const TwistTable& table,
+        uint8_t* result_corner, uint8_t* result_edge
+    ) noexcept {
+        if constexpr (flags == corners_and_edges) {
+            twist(table.corner, table.edge, corner, edge, result_corner, result_edge);
+        } else if constexpr (flags == CubeTwist::corners) {
+            twist_corners(table.corner, corner, result_corner);
+        } else if constexpr (flags == CubeTwist::edges) {
+            twist_edges(table.edge, edge, result_edge);
+        }
+    }
+
+    template<auto twist_corners, auto twist_edges, auto corner_cycles, auto edge_cycles>
+    void placement_cycles(
+        const uint8_t* corner, const uint8_t* edge, const PlacementTable& table,
+        int* result_corner_cycles, int* result_edge_cycles
+    ) noexcept {
+        for (size_t placement = 0; placement < 24; ++placement) {
+            alignas(8) uint8_t placed_corner[8];
+            alignas(16) uint8_t placed_edge[16];
+            twist_corners(corner, table.corner[placement], placed_corner);
+            twist_edges(edge, table.edge[placement], placed_edge);
+            result_corner_cycles[placement] = corner_cycles(placed_corner);
+            result_edge_cycles[placement] = edge_cycles(placed_edge);
+        }
+    }
+};
+
+
+namespace {
+    void twist_corners_scalar(const uint8_t* lhs, const uint8_t* rhs, uint8_t* result) noexcept {
+        uint8_t corner[8];
+        for (size_t i = 0; i < 8; ++i) {
+            corner[i] = Details::twist_corner(lhs[i], rhs[lhs[i] & 0xf]);
+        }
+        std::memcpy(result, corner, 8);
+    }
+
+    void twist_edges_scalar(const uint8_t* lhs, const uint8_t* rhs, uint8_t* result) noexcept {
+        uint8_t edge[16];
+        for (size_t i = 0; i < 16; ++i) {
+            edge[i] = Details::twist_edge(lhs[i], rhs[lhs[i] & 0xf]);
+        }
+        std::memcpy(result, edge, 16);
+    }
+
+    void twist_scalar(
+        const uint8_t* lhs_corner, const uint8_t* lhs_edge,
+        const uint8_t* rhs_corner, const uint8_t* rhs_edge,
+        uint8_t* corner, uint8_t* edge
+    ) noexcept {
+        twist_corners_scalar(lhs_corner, rhs_corner, corner);
+        twist_edges_scalar(lhs_edge, rhs_edge, edge);
+    }
+
+    template<std::byte flags>
+    void twist_move_scalar(
+        const uint8_t* corner, const uint8_t* edge, const TwistTable& table,
+        uint8_t* result_corner, uint8_t* result_edge
+    ) noexcept {
+        if constexpr (static_cast<bool>(flags & CubeTwist::corners)) {
+            for (size_t i = 0; i < 8; ++i) {
+                result_corner[i] = table.corner_state[corner[i]];
+            }
+        }
+        if constexpr (static_cast<bool>(flags & CubeTwist::edges)) {
+            for (size_t i = 0; i < 16; ++i) {
+                result_edge[i] = table.edge_state[edge[i]];
+            }
+        }
+    }
+
+    void inverse_scalar(
+        const uint8_t* corner, const uint8_t* edge,
+        uint8_t* inverse_corner, uint8_t* inverse_edge
+    ) noexcept {
+        uint8_t result_corner[8];
+        uint8_t result_edge[16];
+        for (uint8_t i = 0; i < 8; ++i) {
+            result_corner[corner[i] & 0xf] = i | Details::corner_orientation_inverse[corner[i] >> 4];
+        }
+        for (uint8_t i = 0; i < 16; ++i) {
+            result_edge[edge[i] & 0xf] = i | (edge[i] & 0x10);
+        }
+        std::memcpy(inverse_corner, result_corner, 8);
+        std::memcpy(inverse_edge, result_edge, 16);
+    }
+
+    uint64_t mask_scalar(const uint8_t* corner, const uint8_t* edge) noexcept {
+        uint64_t mask = 0;
+        for (unsigned i = 0; i < 8; ++i) {
+            if (corner[i] != i) {
+                mask |= UINT64_C(1) << i;
+                if ((corner[i] & 0xf) == i) {
+                    mask |= UINT64_C(1) << (i + 32);
+                }
+            }
+        }
+        for (unsigned i = 0; i < 12; ++i) {
+            if (edge[i] != i) {
+                mask |= UINT64_C(1) << (i + 8);
+                if ((edge[i] & 0xf) == i) {
+                    mask |= UINT64_C(1) << (i + 40);
+                }
+            }
+        }
+        return mask;
+    }
+
+    int corner_cycles_scalar(const uint8_t* corner) noexcept {
+        unsigned visited_mask = 0;
+        uint32_t counter = 0;
+        for (unsigned x = 0; x < 8; ++x) {
+            if ((visited_mask & (1 << x)) == 0) {
+                unsigned size = 0;
+                unsigned orientation = 0;
+                unsigned y = x;
+                do {
+                    visited_mask |= 1 << y;
+                    ++size;
+                    orientation += corner[y] >> 4;
+                    y = corner[y] & 0xf;
+                } while (y != x);
+                counter += corner_cycle_counter[size][orientation];
+            }
+        }
+        return corner_cycles_from_counter(counter);
+    }
+
+    int edge_cycles_scalar(const uint8_t* edge) noexcept {
+        unsigned visited_mask = 0;
+        uint32_t counter = 0;
+        for (unsigned x = 0; x < 12; ++x) {
+            if ((visited_mask & (1 << x)) == 0) {
+                unsigned size = 0;
+                unsigned flip = 0;
+                unsigned y = x;
+                do {
+                    visited_mask |= 1 << y;
+                    ++size;
+                    flip ^= edge[y] >> 4;
+                    y = edge[y] & 0xf;
+                } while (y != x);
+                counter += edge_cycle_counter[size][flip];
+            }
+        }
+        return edge_cycles_from_counter(counter);
+    }
+
+    constexpr CubeKernels scalar_kernels {
+        "scalar",
+        twist_scalar, twist_corners_scalar, twist_edges_scalar,
+        {
+            twist_move_scalar<std::byte {0}>,
+            twist_move_scalar<CubeTwist::corners>,
+            twist_move_scalar<CubeTwist::edges>,
+            twist_move_scalar<corners_and_edges>
+        },
+        {
+            twist_move_before<std::byte {0}, twist_scalar, twist_corners_scalar, twist_edges_scalar>,
+            twist_move_before<CubeTwist::corners, twist_scalar, twist_corners_scalar, twist_edges_scalar>,
+            twist_move_before<CubeTwist::edges, twist_scalar, twist_corners_scalar, twist_edges_scalar>,
+            twist_move_before<corners_and_edges, twist_scalar, twist_corners_scalar, twist_edges_scalar>
+        },
+        inverse_scalar, mask_scalar,
+        corner_cycles_scalar, edge_cycles_scalar,
+        placement_cycles<twist_corners_scalar, twist_edges_scalar, corner_cycles_scalar, edge_cycles_scalar>
+    };
+};
+
+
+#ifdef INSERTIONFINDER_X86_KERNELS
+namespace {
+    __attribute__((target("sse4.1")))
+    void twist_corners_sse4(const uint8_t* lhs, const uint8_t* rhs, uint8_t* result) noexcept {
+        __m128i item = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(lhs));
+        __m128i table = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rhs));
+        // orientations add up in the high nibble, and subtracting 3 << 4 wraps around unless the sum reaches 3
+        __m128i sum = _mm_add_epi8(_mm_and_si128(item, _mm_set1_epi8(0x30)), _mm_shuffle_epi8(table, item));
+        __m128i twisted = _mm_min_epu8(sum, _mm_sub_epi8(sum, _mm_set1_epi8(0x30)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(result), twisted);
+    }
+
+    __attribute__((target("sse4.1")))
+    void twist_edges_sse4(const uint8_t* lhs, const uint8_t* rhs, uint8_t* result) noexcept {
+        __m128i item = _mm_load_si128(reinterpret_cast<const __m128i*>(lhs));
+        __m128i table = _mm_load_si128(reinterpret_cast<const __m128i*>(rhs));
+        __m128i twisted = _mm_xor_si128(_mm_shuffle_epi8(table, item), _mm_and_si128(item, _mm_set1_epi8(0x10)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(result), twisted);
+    }
+
+    __attribute__((target("sse4.1")))
+    void twist_sse4(
+        const uint8_t* lhs_corner, const uint8_t* lhs_edge,
+        const uint8_t* rhs_corner, const uint8_t* rhs_edge,
+        uint8_t* corner, uint8_t* edge
+    ) noexcept {
+        twist_corners_sse4(lhs_corner, rhs_corner, corner);
+        twist_edges_sse4(lhs_edge, rhs_edge, edge);
+    }
+
+    __attribute__((target("sse4.1")))
+    uint64_t mask_sse4(const uint8_t* corner, const uint8_t* edge) noexcept {
+        __m128i identity = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        __m128i position = _mm_set1_epi8(0xf);
+        __m128i corner_item = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(corner));
+        __m128i edge_item = _mm_load_si128(reinterpret_cast<const __m128i*>(edge));
+        uint64_t corner_changed = ~_mm_movemask_epi8(_mm_cmpeq_epi8(corner_item, identity)) & 0xff;
+        uint64_t corner_twisted = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_and_si128(corner_item, position), identity)
+        ) & corner_changed;
+        uint64_t edge_changed = ~_mm_movemask_epi8(_mm_cmpeq_epi8(edge_item, identity)) & 0xfff;
+        uint64_t edge_flipped = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_and_si128(edge_item, position), identity)
+        ) & edge_changed;
+        return corner_changed | edge_changed << 8 | corner_twisted << 32 | edge_flipped << 40;
+    }
+
+    // The smallest position reachable within 2^k steps is found by k rounds of shuffle doubling,
+    // so after enough rounds every piece is labeled by the leader of its permutation cycle.
+    __attribute__((target("sse4.1,popcnt")))
+    int corner_cycles_sse4(const uint8_t* corner) noexcept {
+        __m128i identity = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        __m128i item = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(corner));
+        __m128i permutation = _mm_and_si128(item, _mm_set1_epi8(0xf));
+        __m128i leader = identity;
+        for (int round = 0; round < 3; ++round) {
+            leader = _mm_min_epu8(leader, _mm_shuffle_epi8(leader, permutation));
+            permutation = _mm_shuffle_epi8(permutation, permutation);
+        }
+        unsigned leader_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(leader, identity));
+        unsigned solved_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(item, identity));
+        unsigned orientation1 = _mm_movemask_epi8(_mm_slli_epi16(item, 3));
+        unsigned orientation2 = _mm_movemask_epi8(_mm_slli_epi16(item, 2));
+        uint32_t counter = 0;
+        for (unsigned mask = leader_mask & ~solved_mask & 0xff; mask; mask &= mask - 1) {
+            __m128i cycle_leader = _mm_set1_epi8(__builtin_ctz(mask));
+            unsigned cycle = _mm_movemask_epi8(_mm_cmpeq_epi8(leader, cycle_leader)) & 0xff;
+            unsigned orientation = __builtin_popcount(cycle & orientation1)
+                + 2 * __builtin_popcount(cycle & orientation2);
+            counter += corner_cycle_counter[__builtin_popcount(cycle)][orientation];
+        }
+        return corner_cycles_from_counter(counter);
+    }
+
+    __attribute__((target("sse4.1,popcnt")))
+    int edge_cycles_sse4(const uint8_t* edge) noexcept {
+        __m128i identity = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        __m128i item = _mm_load_si128(reinterpret_cast<const __m128i*>(edge));
+        __m128i permutation = _mm_and_si128(item, _mm_set1_epi8(0xf));
+        __m128i leader = identity;
+        for (int round = 0; round < 4; ++round) {
+            leader = _mm_min_epu8(leader, _mm_shuffle_epi8(leader, permutation));
+            permutation = _mm_shuffle_epi8(permutation, permutation);
+        }
+        unsigned leader_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(leader, identity));
+        unsigned solved_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(item, identity));
+        unsigned flip = _mm_movemask_epi8(_mm_slli_epi16(item, 3));
+        uint32_t counter = 0;
+        for (unsigned mask = leader_mask & ~solved_mask & 0xfff; mask; mask &= mask - 1) {
+            __m128i cycle_leader = _mm_set1_epi8(__builtin_ctz(mask));
+            unsigned cycle = _mm_movemask_epi8(_mm_cmpeq_epi8(leader, cycle_leader));
+            counter += edge_cycle_counter[__builtin_popcount(cycle)][__builtin_popcount(cycle & flip) & 1];
+        }
+        return edge_cycles_from_counter(counter);
+    }
+
+    constexpr CubeKernels sse4_kernels {
+        "sse4",
+        twist_sse4, twist_corners_sse4, twist_edges_sse4,
+        {
+            twist_move<std::byte {0}, twist_sse4, twist_corners_sse4, twist_edges_sse4>,
+            twist_move<CubeTwist::corners, twist_sse4, twist_corners_sse4, twist_edges_sse4>,
+            twist_move<CubeTwist::edges, twist_sse4, twist_corners_sse4, twist_edges_sse4>,
+            twist_move<corners_and_edges, twist_sse4, twist_corners_sse4, twist_edges_sse4>
+        },
+        {
+            twist_move_before<std::byte {0}, twist_sse4, twist_corners_sse4, twist_edges_sse4>,
+            twist_move_before<CubeTwist::corners, twist_sse4, twist_corners_sse4, twist_edges_sse4>,
+            twist_move_before<CubeTwist::edges, twist_sse4, twist_corners_sse4, twist_edges_sse4>,
+            twist_move_before<corners_and_edges, twist_sse4, twist_corners_sse4, twist_edges_sse4>
+        },
+        inverse_scalar, mask_sse4,
+        corner_cycles_sse4, edge_cycles_sse4,
+        placement_cycles<twist_corners_sse4, twist_edges_sse4, corner_cycles_sse4, edge_cycles_sse4>
+    };
+};
+
+
+namespace {
+    __attribute__((target("avx2")))
+    inline __m256i load_pieces_avx2(const uint8_t* corner, const uint8_t* edge) noexcept {
+        return _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(edge))),
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(corner)),
+            1
+        );
+    }
+
+    __attribute__((target("avx2")))
+    void twist_corners_avx2(const uint8_t* lhs, const uint8_t* rhs, uint8_t* result) noexcept {
+        __m128i item = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(lhs));
+        __m128i table = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rhs));
+        __m128i sum = _mm_add_epi8(_mm_and_si128(item, _mm_set1_epi8(0x30)), _mm_shuffle_epi8(table, item));
+        __m128i twisted = _mm_min_epu8(sum, _mm_sub_epi8(sum, _mm_set1_epi8(0x30)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(result), twisted);
+    }
+
+    __attribute__((target("avx2")))
+    void twist_edges_avx2(const uint8_t* lhs, const uint8_t* rhs, uint8_t* result) noexcept {
+        __m128i item = _mm_load_si128(reinterpret_cast<const __m128i*>(lhs));
+        __m128i table = _mm_load_si128(reinterpret_cast<const __m128i*>(rhs));
+        __m128i twisted = _mm_xor_si128(_mm_shuffle_epi8(table, item), _mm_and_si128(item, _mm_set1_epi8(0x10)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(result), twisted);
+    }
+
+    // Edges go to the low 128-bit lane and corners to the high one, so a single in-lane shuffle composes both.
+    // Flips are then reduced modulo 2 and twists modulo 3 by the same add-and-wrap step.
+    __attribute__((target("avx2")))
+    void twist_avx2(
+        const uint8_t* lhs_corner, const uint8_t* lhs_edge,
+        const uint8_t* rhs_corner, const uint8_t* rhs_edge,
+        uint8_t* corner, uint8_t* edge
+    ) noexcept {
+        __m256i item = load_pieces_avx2(lhs_corner, lhs_edge);
+        __m256i table = load_pieces_avx2(rhs_corner, rhs_edge);
+        __m256i orientation = _mm256_set_m128i(_mm_set1_epi8(0x30), _mm_set1_epi8(0x10));
+        __m256i modulo = _mm256_set_m128i(_mm_set1_epi8(0x30), _mm_set1_epi8(0x20));
+        __m256i sum = _mm256_add_epi8(_mm256_and_si256(item, orientation), _mm256_shuffle_epi8(table, item));
+        __m256i twisted = _mm256_min_epu8(sum, _mm256_sub_epi8(sum, modulo));
+        _mm_store_si128(reinterpret_cast<__m128i*>(edge), _mm256_castsi256_si128(twisted));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(corner), _mm256_extracti128_si256(twisted, 1));
+    }
+
+    __attribute__((target("avx2")))
+    uint64_t mask_avx2(const uint8_t* corner, const uint8_t* edge) noexcept {
+        __m128i identity128 = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        __m256i identity = _mm256_set_m128i(identity128, identity128);
+        __m256i item = load_pieces_avx2(corner, edge);
+        uint32_t changed = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(item, identity));
+        uint32_t unchanged_position = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_and_si256(item, _mm256_set1_epi8(0xf)), identity)
+        );
+        uint32_t oriented = unchanged_position & changed;
+        return (changed >> 16 & 0xff) | (changed & 0xfff) << 8
+            | static_cast<uint64_t>((oriented >> 16 & 0xff) | (oriented & 0xfff) << 8) << 32;
+    }
+
+    struct PlacementShuffle {
+        alignas(32) uint8_t corner[8][32];
+        alignas(32) uint8_t edge[12][32];
+    };
+
+    // Shuffles moving every piece to the one k slots further, within each state of a placement batch.
+    constexpr PlacementShuffle generate_placement_shuffle() {
+        PlacementShuffle shuffle {};
+        for (size_t k = 0; k < 8; ++k) {
+            for (size_t i = 0; i < 32; ++i) {
+                shuffle.corner[k][i] = (i & 8) | ((i + k) & 7);
+            }
+        }
+        for (size_t k = 0; k < 12; ++k) {
+            for (size_t i = 0; i < 32; ++i) {
+                shuffle.edge[k][i] = (i & 15) < 12 ? ((i & 15) + k) % 12 : 0x80;
+            }
+        }
+        return shuffle;
+    }
+
+    constexpr PlacementShuffle placement_shuffle = generate_placement_shuffle();
+
+    // Four placed corner states or two placed edge states share a register. Each piece finds the size and
+    // the orientation sum of its cycle by comparing cycle leaders with the pieces k slots further, and the
+    // counter bytes of the cycle leaders are then added up by byte sums.
+    __attribute__((target("avx2")))
+    void placement_cycles_avx2(
+        const uint8_t* corner, const uint8_t* edge, const PlacementTable& table,
+        int* corner_cycles, int* edge_cycles
+    ) noexcept {
+        __m128i identity128 = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        __m256i identity = _mm256_set_m128i(identity128, identity128);
+        __m256i zero = _mm256_setzero_si256();
+        __m256i one = _mm256_set1_epi8(1);
+        __m256i two = _mm256_set1_epi8(2);
+        __m256i three = _mm256_set1_epi8(3);
+        __m256i sixteen = _mm256_set1_epi8(0x10);
+        __m256i position_mask = _mm256_set1_epi8(0xf);
+        alignas(32) uint64_t counter[4];
+
+        uint64_t corner_word;
+        std::memcpy(&corner_word, corner, 8);
+        __m256i corner_item = _mm256_set1_epi64x(corner_word);
+        __m256i corner_base = _mm256_and_si256(identity, _mm256_set1_epi8(8));
+        __m256i corner_position = _mm256_or_si256(_mm256_and_si256(corner_item, position_mask), corner_base);
+        __m256i corner_orientation = _mm256_and_si256(corner_item, _mm256_set1_epi8(0x30));
+        for (size_t begin = 0; begin < 24; begin += 4) {
+            __m256i rotation = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.corner[begin]));
+            __m256i sum = _mm256_add_epi8(corner_orientation, _mm256_shuffle_epi8(rotation, corner_position));
+            __m256i item = _mm256_min_epu8(sum, _mm256_sub_epi8(sum, _mm256_set1_epi8(0x30)));
+            __m256i permutation = _mm256_or_si256(_mm256_and_si256(item, position_mask), corner_base);
+            __m256i leader = identity;
+            for (int round = 0; round < 3; ++round) {
+                leader = _mm256_min_epu8(leader, _mm256_shuffle_epi8(leader, permutation));
+                permutation = _mm256_shuffle_epi8(permutation, permutation);
+            }
+            __m256i orientation = _mm256_srli_epi16(_mm256_and_si256(item, _mm256_set1_epi8(0x30)), 4);
+            __m256i size = one;
+            __m256i orientation_sum = orientation;
+            for (size_t k = 1; k < 8; ++k) {
+                __m256i shuffle = _mm256_load_si256(reinterpret_cast<const __m256i*>(placement_shuffle.corner[k]));
+                __m256i same = _mm256_cmpeq_epi8(_mm256_shuffle_epi8(leader, shuffle), leader);
+                size = _mm256_sub_epi8(size, same);
+                orientation_sum = _mm256_add_epi8(
+                    orientation_sum,
+                    _mm256_and_si256(_mm256_shuffle_epi8(orientation, shuffle), same)
+                );
+                orientation_sum = _mm256_min_epu8(orientation_sum, _mm256_sub_epi8(orientation_sum, three));
+            }
+            __m256i is_leader = _mm256_cmpeq_epi8(leader, identity);
+            __m256i single = _mm256_cmpeq_epi8(size, one);
+            __m256i even = _mm256_cmpeq_epi8(_mm256_and_si256(size, one), zero);
+            __m256i odd = _mm256_andnot_si256(_mm256_or_si256(single, even), is_leader);
+            single = _mm256_and_si256(single, is_leader);
+            even = _mm256_and_si256(even, is_leader);
+            __m256i orientation0 = _mm256_cmpeq_epi8(orientation_sum, zero);
+            __m256i orientation1 = _mm256_cmpeq_epi8(orientation_sum, one);
+            __m256i orientation2 = _mm256_cmpeq_epi8(orientation_sum, two);
+            __m256i counter0 = _mm256_or_si256(
+                _mm256_and_si256(_mm256_and_si256(single, orientation1), one),
+                _mm256_and_si256(_mm256_and_si256(single, orientation2), sixteen)
+            );
+            __m256i counter1 = _mm256_or_si256(
+                _mm256_and_si256(_mm256_and_si256(odd, orientation1), one),
+                _mm256_and_si256(_mm256_and_si256(odd, orientation2), sixteen)
+            );
+            __m256i counter2 = _mm256_or_si256(
+                _mm256_and_si256(_mm256_and_si256(even, orientation0), one),
+                _mm256_and_si256(_mm256_and_si256(even, orientation1), sixteen)
+            );
+            __m256i counter3 = _mm256_or_si256(
+                _mm256_and_si256(_mm256_and_si256(even, orientation2), one),
+                _mm256_and_si256(_mm256_slli_epi16(size, 3), _mm256_and_si256(is_leader, _mm256_set1_epi8(0x70)))
+            );
+            __m256i counters = _mm256_or_si256(
+                _mm256_or_si256(_mm256_sad_epu8(counter0, zero), _mm256_slli_epi64(_mm256_sad_epu8(counter1, zero), 8)),
+                _mm256_or_si256(
+                    _mm256_slli_epi64(_mm256_sad_epu8(counter2, zero), 16),
+                    _mm256_slli_epi64(_mm256_sad_epu8(counter3, zero), 24)
+                )
+            );
+            _mm256_store_si256(reinterpret_cast<__m256i*>(counter), counters);
+            for (size_t i = 0; i < 4; ++i) {
+                corner_cycles[begin + i] = corner_cycles_from_counter(counter[i]);
+            }
+        }
+
+        __m256i edge_item = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(edge)));
+        __m256i edge_position = _mm256_and_si256(edge_item, position_mask);
+        __m256i edge_flip = _mm256_and_si256(edge_item, sixteen);
+        for (size_t begin = 0; begin < 24; begin += 2) {
+            __m256i rotation = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.edge[begin]));
+            __m256i item = _mm256_xor_si256(_mm256_shuffle_epi8(rotation, edge_position), edge_flip);
+            __m256i permutation = _mm256_and_si256(item, position_mask);
+            __m256i leader = identity;
+            for (int round = 0; round < 4; ++round) {
+                leader = _mm256_min_epu8(leader, _mm256_shuffle_epi8(leader, permutation));
+                permutation = _mm256_shuffle_epi8(permutation, permutation);
+            }
+            __m256i flip = _mm256_srli_epi16(_mm256_and_si256(item, sixteen), 4);
+            __m256i size = one;
+            __m256i flip_sum = flip;
+            for (size_t k = 1; k < 12; ++k) {
+                __m256i shuffle = _mm256_load_si256(reinterpret_cast<const __m256i*>(placement_shuffle.edge[k]));
+                __m256i same = _mm256_cmpeq_epi8(_mm256_shuffle_epi8(leader, shuffle), leader);
+                size = _mm256_sub_epi8(size, same);
+                flip_sum = _mm256_xor_si256(flip_sum, _mm256_and_si256(_mm256_shuffle_epi8(flip, shuffle), same));
+            }
+            __m256i is_leader = _mm256_cmpeq_epi8(leader, identity);
+            __m256i single = _mm256_cmpeq_epi8(size, one);
+            __m256i even = _mm256_cmpeq_epi8(_mm256_and_si256(size, one), zero);
+            __m256i odd = _mm256_andnot_si256(_mm256_or_si256(single, even), is_leader);
+            __m256i flipped = _mm256_cmpeq_epi8(flip_sum, one);
+            single = _mm256_and_si256(single, is_leader);
+            even = _mm256_and_si256(even, is_leader);
+            __m256i counter0 = _mm256_or_si256(
+                _mm256_and_si256(_mm256_and_si256(single, flipped), one),
+                _mm256_and_si256(_mm256_and_si256(odd, flipped), sixteen)
+            );
+            __m256i counter1 = _mm256_or_si256(
+                _mm256_and_si256(_mm256_and_si256(even, flipped), one),
+                _mm256_and_si256(even, sixteen)
+            );
+            __m256i counter2 = _mm256_and_si256(
+                _mm256_srli_epi16(size, 1),
+                _mm256_and_si256(is_leader, _mm256_set1_epi8(0x7f))
+            );
+            __m256i counters = _mm256_or_si256(
+                _mm256_or_si256(_mm256_sad_epu8(counter0, zero), _mm256_slli_epi64(_mm256_sad_epu8(counter1, zero), 8)),
+                _mm256_slli_epi64(_mm256_sad_epu8(counter2, zero), 16)
+            );
+            counters = _mm256_add_epi64(counters, _mm256_srli_si256(counters, 8));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(counter), counters);
+            edge_cycles[begin] = edge_cycles_from_counter(counter[0]);
+            edge_cycles[begin + 1] = edge_cycles_from_counter(counter[2]);
+        }
+    }
+
+    constexpr CubeKernels avx2_kernels {
+        "avx2",
+        twist_avx2, twist_corners_avx2, twist_edges_avx2,
+        {
+            twist_move<std::byte {0}, twist_avx2, twist_corners_avx2, twist_edges_avx2>,
+            twist_move<CubeTwist::corners, twist_avx2, twist_corners_avx2, twist_edges_avx2>,
+            twist_move<CubeTwist::edges, twist_avx2, twist_corners_avx2, twist_edges_avx2>,
+            twist_move<corners_and_edges, twist_avx2, twist_corners_avx2, twist_edges_avx2>
+        },
+        {
+            twist_move_before<std::byte {0}, twist_avx2, twist_corners_avx2, twist_edges_avx2>,
+            twist_move_before<CubeTwist::corners, twist_avx2, twist_corners_avx2, twist_edges_avx2>,
+            twist_move_before<CubeTwist::edges, twist_avx2, twist_corners_avx2, twist_edges_avx2>,
+            twist_move_before<corners_and_edges, twist_avx2, twist_corners_avx2, twist_edges_avx2>
+        },
+        inverse_scalar, mask_avx2,
+        corner_cycles_sse4, edge_cycles_sse4,
+        placement_cycles_avx2
+    };
+};
+#endif
+
+
+namespace {
+    constexpr const CubeKernels* all_cube_kernels[] = {
+#ifdef INSERTIONFINDER_X86_KERNELS
+        &avx2_kernels, &sse4_kernels,
+#endif
+        &scalar_kernels
+    };
+
+    bool cube_kernels_supported(const CubeKernels* kernels) noexcept {
+#ifdef INSERTIONFINDER_X86_KERNELS
+        __builtin_cpu_init();
+        if (kernels == &avx2_kernels) {
+            return __builtin_cpu_supports("avx2");
+        }
+        if (kernels == &sse4_kernels) {
+            return __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt");
+        }
+#endif
+        return true;
+    }
+
+    const CubeKernels* select_cube_kernels() noexcept {
+        for (const CubeKernels* kernels: all_cube_kernels) {
+            if (cube_kernels_supported(kernels)) {
+                return kernels;
+            }
+        }
+        return &scalar_kernels;
+    }
+};
+
+
+const CubeKernels* Details::cube_kernels = &scalar_kernels;
+
+namespace {
+    const bool cube_kernels_selected = (Details::cube_kernels = select_cube_kernels()) != nullptr;
+};
+
+const CubeKernels* Details::find_cube_kernels(const char* name) noexcept {
+    for (const CubeKernels* kernels: all_cube_kernels) {
+        if (std::strcmp(kernels->name, name) == 0) {
+            return cube_kernels_supported(kernels) ? kernels : nullptr;
+        }
+    }
+    return nullptr;
+}
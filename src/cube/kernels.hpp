@@ -0,0 +1,191 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <array>
+#include <insertionfinder/cube.hpp>
+
+namespace InsertionFinder::Details {
+    struct TwistTable {
+        alignas(16) std::uint8_t edge[16];
+        alignas(8) std::uint8_t corner[8];
+        std::uint8_t edge_state[32];
+        std::uint8_t corner_state[48];
+    };
+
+    struct PlacementTable {
+        alignas(32) std::uint8_t corner[24][8];
+        alignas(32) std::uint8_t edge[24][16];
+    };
+
+    // Each permutation cycle is summarized by its size and orientation sum, and its contribution to the cycle
+    // counts is accumulated into 4-bit counters so that cycle classification needs no branches.
+    constexpr std::array<std::array<std::uint32_t, 17>, 9> generate_corner_cycle_counter_table() {
+        std::array<std::array<std::uint32_t, 17>, 9> table {};
+        for (std::size_t size = 1; size <= 8; ++size) {
+            for (std::size_t sum = 0; sum <= 16; ++sum) {
+                std::size_t orientation = sum % 3;
+                std::uint32_t counter = ((size - 1) >> 1) << 28;
+                if (size == 1) {
+                    counter |= orientation ? 1 << ((orientation - 1) << 2) : 0;
+                } else if (size & 1) {
+                    counter |= orientation ? 1 << (((orientation - 1) << 2) + 8) : 0;
+                } else {
+                    counter += 1 << 28;
+                    counter |= 1 << ((orientation << 2) + 16);
+                }
+                table[size][sum] = counter;
+            }
+        }
+        return table;
+    }
+
+    constexpr std::array<std::array<std::uint32_t, 2>, 13> generate_edge_cycle_counter_table() {
+        std::array<std::array<std::uint32_t, 2>, 13> table {};
+        for (std::size_t size = 1; size <= 12; ++size) {
+            for (std::size_t flip = 0; flip < 2; ++flip) {
+                std::uint32_t counter = ((size - 1) >> 1) << 16;
+                if ((size & 1) == 0) {
+                    counter += 1 << 16;
+                    counter |= 1 << 12;
+                }
+                if (flip) {
+                    if (size == 1) {
+                        counter |= 1;
+                    } else if (size & 1) {
+                        counter |= 1 << 4;
+                    } else {
+                        counter |= 1 << 8;
+                    }
+                }
+                table[size][flip] = counter;
+            }
+        }
+        return table;
+    }
+
+    inline constexpr std::array<std::array<std::uint32_t, 17>, 9> corner_cycle_counter =
+        generate_corner_cycle_counter_table();
+    inline constexpr std::array<std::array<std::uint32_t, 2>, 13> edge_cycle_counter =
+        generate_edge_cycle_counter_table();
+
+    inline int corner_cycles_from_counter(std::uint32_t counter) noexcept {
+        int self_orientation[3] = {0, static_cast<int>(counter & 0xf), static_cast<int>(counter >> 4 & 0xf)};
+        int even_permutation[3] = {0, static_cast<int>(counter >> 8 & 0xf), static_cast<int>(counter >> 12 & 0xf)};
+        int odd_permutation[3] = {
+            static_cast<int>(counter >> 16 & 0xf),
+            static_cast<int>(counter >> 20 & 0xf),
+            static_cast<int>(counter >> 24 & 0xf)
+        };
+        int cycles = counter >> 28;
+
+        int parity = (odd_permutation[0] + odd_permutation[1] + odd_permutation[2]) & 1;
+        int has_odd0 = odd_permutation[0] != 0;
+        int less = odd_permutation[1] < odd_permutation[2];
+        int parity1 = parity & (has_odd0 ^ 1) & (less ^ 1);
+        int parity2 = parity & (has_odd0 ^ 1) & less;
+        cycles -= parity;
+        odd_permutation[0] -= parity & has_odd0;
+        odd_permutation[1] -= parity1;
+        even_permutation[1] += parity1;
+        odd_permutation[2] -= parity2;
+        even_permutation[2] += parity2;
+
+        less = odd_permutation[1] < odd_permutation[2];
+        int odd0 = odd_permutation[0] & 1;
+        int half_difference = std::abs(odd_permutation[1] - odd_permutation[2]) >> 1;
+        even_permutation[1] += odd0 + (half_difference - odd0) * less;
+        even_permutation[2] += half_difference + (odd0 - half_difference) * less;
+
+        int x = self_orientation[1] + even_permutation[1];
+        int y = self_orientation[2] + even_permutation[2];
+        cycles += (x / 3 + y / 3) << 1;
+        int twists = x % 3;
+        return cycles + twists + (even_permutation[1] + even_permutation[2] < twists);
+    }
+
+    inline int edge_cycles_from_counter(std::uint32_t counter) noexcept {
+        static constexpr int flip_cycles[7] = {0, 2, 3, 5, 6, 8, 9};
+        int self_flip = counter & 0xf;
+        int even_flip = (counter >> 4 & 0xf) + (counter >> 8 & 1);
+        int cycles = (counter >> 16) - (counter >> 12 & 1);
+        int less = self_flip < even_flip;
+        int paired = (self_flip + even_flip) >> 1;
+        int unpaired = even_flip + flip_cycles[std::max(self_flip - even_flip, 0) >> 1];
+        return cycles + unpaired + (paired - unpaired) * less;
+    }
+
+    struct CubeKernels {
+        const char* name;
+        void (*twist)(
+            const std::uint8_t* lhs_corner, const std::uint8_t* lhs_edge,
+            const std::uint8_t* rhs_corner, const std::uint8_t* rhs_edge,
+            std::uint8_t* corner, std::uint8_t* edge
+        ) noexcept;
+        void (*twist_corners)(const std::uint8_t* lhs, const std::uint8_t* rhs, std::uint8_t* result) noexcept;
+        void (*twist_edges)(const std::uint8_t* lhs, const std::uint8_t* rhs, std::uint8_t* result) noexcept;
+        // twist_move and twist_move_before are indexed by the corners and edges bits of the twist flags
+        void (*twist_move[4])(
+            const std::uint8_t* corner, const std::uint8_t* edge, const TwistTable& twist,
+            std::uint8_t* result_corner, std::uint8_t* result_edge
+        ) noexcept;
+        void (*twist_move_before[4])(
+            const std::uint8_t* corner, const std::uint8_t* edge, const TwistTable& twist,
+            std::uint8_t* result_corner, std::uint8_t* result_edge
+        ) noexcept;
+        void (*inverse)(
+            const std::uint8_t* corner, const std::uint8_t* edge,
+            std::uint8_t* inverse_corner, std::uint8_t* inverse_edge
+        ) noexcept;
+        std::uint64_t (*mask)(const std::uint8_t* corner, const std::uint8_t* edge) noexcept;
+        int (*corner_cycles)(const std::uint8_t* corner) noexcept;
+        int (*edge_cycles)(const std::uint8_t* edge) noexcept;
+        void (*placement_cycles)(
+            const std::uint8_t* corner, const std::uint8_t* edge, const PlacementTable& table,
+            int* corner_cycles, int* edge_cycles
+        ) noexcept;
+    };
+
+    extern const CubeKernels* cube_kernels;
+    // the kernel set with this name, or nullptr if it is unknown or the CPU lacks its instructions
+    const CubeKernels* find_cube_kernels(const char* name) noexcept;
+
+    constexpr std::size_t twist_move_index(std::byte flags) {
+        return std::to_integer<std::size_t>(flags & (CubeTwist::corners | CubeTwist::edges));
+    }
+
+    template<std::byte flags>
+    inline void twist_pieces(
+        const std::uint8_t* lhs_corner, const std::uint8_t* lhs_edge,
+        const std::uint8_t* rhs_corner, const std::uint8_t* rhs_edge,
+        std::uint8_t* corner, std::uint8_t* edge
+    ) noexcept {
+        if constexpr (static_cast<bool>(flags & CubeTwist::corners)) {
+            if constexpr (static_cast<bool>(flags & CubeTwist::edges)) {
+                cube_kernels->twist(lhs_corner, lhs_edge, rhs_corner, rhs_edge, corner, edge);
+            } else {
+                cube_kernels->twist_corners(lhs_corner, rhs_corner, corner);
+            }
+        } else if constexpr (static_cast<bool>(flags & CubeTwist::edges)) {
+            cube_kernels->twist_edges(lhs_edge, rhs_edge, edge);
+        }
+    }
+
+    inline void twist_pieces(
+        const std::uint8_t* lhs_corner, const std::uint8_t* lhs_edge,
+        const std::uint8_t* rhs_corner, const std::uint8_t* rhs_edge,
+        std::uint8_t* corner, std::uint8_t* edge,
+        std::byte flags
+    ) noexcept {
+        if (static_cast<bool>(flags & CubeTwist::corners)) {
+            if (static_cast<bool>(flags & CubeTwist::edges)) {
+                cube_kernels->twist(lhs_corner, lhs_edge, rhs_corner, rhs_edge, corner, edge);
+            } else {
+                cube_kernels->twist_corners(lhs_corner, rhs_corner, corner);
+            }
+        } else if (static_cast<bool>(flags & CubeTwist::edges)) {
+            cube_kernels->twist_edges(lhs_edge, rhs_edge, edge);
+        }
+    }
+};
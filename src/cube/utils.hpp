@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace InsertionFinder::Details {
+    // A corner is stored as position | orientation << 4 and an edge as position | flip << 4,
+    // so the low nibble can be used directly as a shuffle index.
+    constexpr unsigned corner_value(std::uint8_t item) {
+        return (item & 0xf) * 3 + (item >> 4);
+    }
+    constexpr std::uint8_t corner_item(unsigned value) {
+        return value / 3 | value % 3 << 4;
+    }
+    constexpr unsigned edge_value(std::uint8_t item) {
+        return (item & 0xf) << 1 | item >> 4;
+    }
+    constexpr std::uint8_t edge_item(unsigned value) {
+        return value >> 1 | (value & 1) << 4;
+    }
+
+    constexpr std::uint8_t corner_orientation_sum[5] = {0x00, 0x10, 0x20, 0x00, 0x10};
+    constexpr std::uint8_t corner_orientation_inverse[3] = {0x00, 0x20, 0x10};
+
+    constexpr std::uint8_t twist_corner(std::uint8_t item, std::uint8_t transform) {
+        return (transform & 0xf) | corner_orientation_sum[(item + transform) >> 4];
+    }
+    constexpr std::uint8_t twist_edge(std::uint8_t item, std::uint8_t transform) {
+        return transform ^ (item & 0x10);
+    }
+
+    alignas(8) inline constexpr std::uint8_t corner_twist_table[24][8] = {
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07},
+        {0x03, 0x00, 0x01, 0x02, 0x04, 0x05, 0x06, 0x07},
+        {0x02, 0x03, 0x00, 0x01, 0x04, 0x05, 0x06, 0x07},
+        {0x01, 0x02, 0x03, 0x00, 0x04, 0x05, 0x06, 0x07},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07},
+        {0x00, 0x01, 0x02, 0x03, 0x05, 0x06, 0x07, 0x04},
+        {0x00, 0x01, 0x02, 0x03, 0x06, 0x07, 0x04, 0x05},
+        {0x00, 0x01, 0x02, 0x03, 0x07, 0x04, 0x05, 0x06},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07},
+        {0x00, 0x01, 0x23, 0x17, 0x04, 0x05, 0x12, 0x26},
+        {0x00, 0x01, 0x07, 0x06, 0x04, 0x05, 0x03, 0x02},
+        {0x00, 0x01, 0x26, 0x12, 0x04, 0x05, 0x17, 0x23},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07},
+        {0x21, 0x15, 0x02, 0x03, 0x10, 0x24, 0x06, 0x07},
+        {0x05, 0x04, 0x02, 0x03, 0x01, 0x00, 0x06, 0x07},
+        {0x24, 0x10, 0x02, 0x03, 0x15, 0x21, 0x06, 0x07},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07},
+        {0x00, 0x22, 0x16, 0x03, 0x04, 0x11, 0x25, 0x07},
+        {0x00, 0x06, 0x05, 0x03, 0x04, 0x02, 0x01, 0x07},
+        {0x00, 0x25, 0x11, 0x03, 0x04, 0x16, 0x22, 0x07},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07},
+        {0x14, 0x01, 0x02, 0x20, 0x27, 0x05, 0x06, 0x13},
+        {0x07, 0x01, 0x02, 0x04, 0x03, 0x05, 0x06, 0x00},
+        {0x13, 0x01, 0x02, 0x27, 0x20, 0x05, 0x06, 0x14}
+    };
+
+    alignas(16) inline constexpr std::uint8_t edge_twist_table[24][16] = {
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x03, 0x00, 0x01, 0x02, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x02, 0x03, 0x00, 0x01, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x01, 0x02, 0x03, 0x00, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x03, 0x05, 0x06, 0x07, 0x04, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x03, 0x06, 0x07, 0x04, 0x05, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x03, 0x07, 0x04, 0x05, 0x06, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x0b, 0x04, 0x05, 0x06, 0x0a, 0x08, 0x09, 0x03, 0x07, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x07, 0x04, 0x05, 0x06, 0x03, 0x08, 0x09, 0x0b, 0x0a, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x0a, 0x04, 0x05, 0x06, 0x0b, 0x08, 0x09, 0x07, 0x03, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x09, 0x02, 0x03, 0x04, 0x08, 0x06, 0x07, 0x01, 0x05, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x05, 0x02, 0x03, 0x04, 0x01, 0x06, 0x07, 0x09, 0x08, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x08, 0x02, 0x03, 0x04, 0x09, 0x06, 0x07, 0x05, 0x01, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x1a, 0x03, 0x04, 0x05, 0x19, 0x07, 0x08, 0x12, 0x16, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x06, 0x03, 0x04, 0x05, 0x02, 0x07, 0x08, 0x0a, 0x09, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x19, 0x03, 0x04, 0x05, 0x1a, 0x07, 0x08, 0x16, 0x12, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x18, 0x01, 0x02, 0x03, 0x1b, 0x05, 0x06, 0x07, 0x14, 0x09, 0x0a, 0x10, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x04, 0x01, 0x02, 0x03, 0x00, 0x05, 0x06, 0x07, 0x0b, 0x09, 0x0a, 0x08, 0x0c, 0x0d, 0x0e, 0x0f},
+        {0x1b, 0x01, 0x02, 0x03, 0x18, 0x05, 0x06, 0x07, 0x10, 0x09, 0x0a, 0x14, 0x0c, 0x0d, 0x0e, 0x0f}
+    };
+};
@@ -2,11 +2,13 @@
 #include <cstdint>
 #include <iostream>
 #include <utility>
+#include <vector>
 #include <insertionfinder/algorithm.hpp>
 #include <insertionfinder/case.hpp>
 #include <insertionfinder/cube.hpp>
 #include <insertionfinder/insertion.hpp>
 #include <insertionfinder/twist.hpp>
+#include <insertionfinder/utils.hpp>
 #include <insertionfinder/finder/brute-force.hpp>
 #include "utils.hpp"
 using std::size_t;
@@ -15,6 +17,7 @@ using InsertionFinder::Algorithm;
 using InsertionFinder::BruteForceFinder;
 using InsertionFinder::Case;
 using InsertionFinder::Cube;
+using InsertionFinder::CubeBatch;
 using InsertionFinder::Insertion;
 using InsertionFinder::InsertionAlgorithm;
 using InsertionFinder::Rotation;
@@ -34,6 +37,23 @@ namespace {
 };
 
 
+void BruteForceFinder::Worker::search(CycleStatus cycle_status, size_t begin, size_t end) {
+    std::byte twist_flag{0};
+    if (this->finder.change_corner) {
+        twist_flag |= CubeTwist::corners;
+    }
+    if (this->finder.change_edge) {
+        twist_flag |= CubeTwist::edges;
+    }
+    if (this->finder.change_center) {
+        twist_flag |= CubeTwist::centers;
+    }
+    Details::dispatch_twist_flag(twist_flag, [&](auto flag) {
+        this->search<decltype(flag)::value>(cycle_status, begin, end);
+    });
+}
+
+template<std::byte twist_flag>
 void BruteForceFinder::Worker::search(CycleStatus cycle_status, size_t begin, size_t end) {
     bool parity = cycle_status.parity;
     int corner_cycles = cycle_status.corner_cycles;
@@ -54,17 +74,6 @@ void BruteForceFinder::Worker::search(CycleStatus cycle_status, size_t begin, si
     }
 
     const Algorithm skeleton = this->solving_step.back().skeleton;
-    std::byte twist_flag{0};
-    if (this->finder.change_corner) {
-        twist_flag |= CubeTwist::corners;
-    }
-    if (this->finder.change_edge) {
-        twist_flag |= CubeTwist::edges;
-    }
-    if (this->finder.change_center) {
-        twist_flag |= CubeTwist::centers;
-    }
-
     Cube state;
     for (size_t insert_place = begin; insert_place <= end; ++insert_place) {
         if (insert_place == begin) {
@@ -74,21 +83,21 @@ void BruteForceFinder::Worker::search(CycleStatus cycle_status, size_t begin, si
             state.twist(skeleton, 0, insert_place, twist_flag);
         } else {
             Twist twist = skeleton[insert_place - 1];
-            state.twist_before(twist.inverse(), twist_flag);
-            state.twist(twist, twist_flag);
+            state.twist_before<twist_flag>(twist.inverse());
+            state.twist<twist_flag>(twist);
         }
-        this->try_insertion(insert_place, state, cycle_status);
+        this->try_insertion<twist_flag>(insert_place, state, cycle_status);
 
         if (skeleton.swappable(insert_place)) {
             Twist twist0 = skeleton[insert_place - 1];
             Twist twist1 = skeleton[insert_place];
             Cube swapped_state;
-            swapped_state.twist(twist0, twist_flag);
-            swapped_state.twist(twist1.inverse(), twist_flag);
-            swapped_state.twist(state, twist_flag);
-            swapped_state.twist(twist1, twist_flag);
-            swapped_state.twist(twist0.inverse(), twist_flag);
-            this->try_insertion(insert_place, swapped_state, cycle_status, true);
+            swapped_state.twist<twist_flag>(twist0);
+            swapped_state.twist<twist_flag>(twist1.inverse());
+            swapped_state.twist<twist_flag>(state);
+            swapped_state.twist<twist_flag>(twist1);
+            swapped_state.twist<twist_flag>(twist0.inverse());
+            this->try_insertion<twist_flag>(insert_place, swapped_state, cycle_status, true);
         }
     }
 }
@@ -160,6 +169,7 @@ void BruteForceFinder::Worker::search_last_placement(Rotation placement, size_t
     }
 }
 
+template<std::byte twist_flag>
 void BruteForceFinder::Worker::try_insertion(
     size_t insert_place,
     const Cube& state,
@@ -172,48 +182,49 @@ void BruteForceFinder::Worker::try_insertion(
     }
     insertion.insert_place = insert_place;
     uint64_t mask = state.mask();
-    bool corner_solved = !(mask & 0xff);
-    bool edge_solved = !(mask & 0xfff00);
-    bool center_solved = !(mask & 0x3f00000);
-    std::byte case_flag {0};
-    if (!corner_solved) {
-        case_flag |= CubeTwist::corners;
-    }
-    if (!edge_solved) {
-        case_flag |= CubeTwist::edges;
-    }
-    if (!center_solved) {
-        case_flag |= CubeTwist::centers;
-    }
+    bool corner_solved = !static_cast<bool>(twist_flag & CubeTwist::corners) || !(mask & 0xff);
+    bool edge_solved = !static_cast<bool>(twist_flag & CubeTwist::edges) || !(mask & 0xfff00);
     auto insert_place_mask = insertion.skeleton.get_insert_place_mask(insert_place);
     bool parity = cycle_status.parity;
     int corner_cycles = cycle_status.corner_cycles;
     int edge_cycles = cycle_status.edge_cycles;
     Rotation placement = cycle_status.placement;
 
-    for (const Case& _case: this->finder.cases) {
+    size_t depth = this->solving_step.size() - 1;
+    if (depth >= this->case_batches.size()) {
+        this->case_batches.resize(depth + 1);
+    }
+    CubeBatch::Result& case_batch = this->case_batches[depth];
+    const std::vector<Case>& cases = this->finder.cases;
+    this->finder.case_states.twist_before(state, case_batch, [&](size_t index) {
+        uint64_t case_mask = cases[index].get_mask();
+        std::byte case_flag {0};
+        if (Details::bitcount_less_than_2(mask & case_mask & 0xffffffff)) {
+            return case_flag;
+        }
+        if (!corner_solved && (case_mask & 0xff)) {
+            case_flag |= CubeTwist::corners;
+        }
+        if (!edge_solved && (case_mask & 0xfff00)) {
+            case_flag |= CubeTwist::edges;
+        }
+        return case_flag;
+    });
+
+    for (size_t index = 0; index < cases.size(); ++index) {
+        const Case& _case = cases[index];
         if (Details::bitcount_less_than_2(mask & _case.get_mask() & 0xffffffff)) {
             continue;
         }
         bool corner_changed = _case.get_mask() & 0xff;
         bool edge_changed = _case.get_mask() & 0xfff00;
-        bool center_changed = _case.get_mask() & 0x3f00000;
-        std::byte twist_flag {0};
-        if (corner_changed) {
-            twist_flag |= CubeTwist::corners;
-        }
-        if (edge_changed) {
-            twist_flag |= CubeTwist::edges;
-        }
-        if (center_changed) {
-            twist_flag |= CubeTwist::centers;
-        }
-        Cube cube = Cube::twist(state, _case.get_state(), case_flag, twist_flag);
         bool new_parity = parity ^ _case.has_parity();
         int new_corner_cycles = corner_changed
-            ? (corner_solved ? _case.get_corner_cycles() : cube.corner_cycles())
+            ? (corner_solved ? _case.get_corner_cycles() : case_batch.get_corner_cycles(index))
             : corner_cycles;
-        int new_edge_cycles = edge_changed ? (edge_solved ? _case.get_edge_cycles() : cube.edge_cycles()) : edge_cycles;
+        int new_edge_cycles = edge_changed
+            ? (edge_solved ? _case.get_edge_cycles() : case_batch.get_edge_cycles(index))
+            : edge_cycles;
         Rotation new_placement = _case.get_placement() * placement;
         if (!new_parity && new_corner_cycles == 0 && new_edge_cycles == 0 && new_placement == 0) {
             this->solution_found(insert_place, _case);
@@ -221,30 +232,25 @@ void BruteForceFinder::Worker::try_insertion(
             this->finder.get_total_cycles(new_parity, new_corner_cycles, new_edge_cycles, new_placement)
             < this->finder.get_total_cycles(parity, corner_cycles, edge_cycles, placement)
         ) {
-            for (const InsertionAlgorithm& algorithm: _case.algorithm_list()) {
-                Insertion& insertion = this->solving_step.back();
-                insertion.insertion = &algorithm;
-                if (!insertion.skeleton.is_worthy_insertion(
-                    algorithm, insert_place,
-                    insert_place_mask,
-                    this->finder.fewest_moves
-                )) {
-                    continue;
+            auto target = [&]() -> size_t {
+                return this->finder.fewest_moves;
+            };
+            Details::for_each_fitting_insertion(
+                insertion.skeleton, _case, insert_place, insert_place_mask, target,
+                [&](const InsertionAlgorithm& algorithm) {
+                    insertion.insertion = &algorithm;
+                    size_t new_begin = insertion.skeleton.insert_into(this->new_skeleton, algorithm, insert_place);
+                    if (not_searched(insertion.skeleton, insert_place, new_begin, swapped)) {
+                        size_t new_end = this->new_skeleton.length();
+                        this->solving_step.emplace_back(this->new_skeleton);
+                        this->search<twist_flag>(
+                            {new_parity, new_corner_cycles, new_edge_cycles, new_placement},
+                            new_begin, new_end
+                        );
+                        this->solving_step.pop_back();
+                    }
                 }
-                auto [new_skeleton, new_begin] = insertion.skeleton.insert(algorithm, insert_place);
-                if (
-                    not_searched(insertion.skeleton, insert_place, new_begin, swapped)
-                    && new_skeleton.length() <= this->finder.fewest_moves
-                ) {
-                    size_t new_end = new_skeleton.length();
-                    this->solving_step.emplace_back(std::move(new_skeleton));
-                    this->search(
-                        {new_parity, new_corner_cycles, new_edge_cycles, new_placement},
-                        new_begin, new_end
-                    );
-                    this->solving_step.pop_back();
-                }
-            }
+            );
         }
     }
     if (swapped) {
@@ -269,20 +275,19 @@ void BruteForceFinder::Worker::solution_found(size_t insert_place, const Case& _
     Insertion& insertion = this->solving_step.back();
     insertion.insert_place = insert_place;
     auto insert_place_mask = insertion.skeleton.get_insert_place_mask(insert_place);
-    for (const InsertionAlgorithm& algorithm: _case.algorithm_list()) {
-        Insertion& insertion = this->solving_step.back();
-        insertion.insertion = &algorithm;
-        if (!insertion.skeleton.is_worthy_insertion(
-            algorithm, insert_place,
-            insert_place_mask,
-            this->finder.fewest_moves
-        )) {
-            continue;
+    auto target = [&]() -> size_t {
+        return this->finder.fewest_moves;
+    };
+    Details::for_each_fitting_insertion(
+        insertion.skeleton, _case, insert_place, insert_place_mask, target,
+        [&](const InsertionAlgorithm& algorithm) {
+            insertion.insertion = &algorithm;
+            insertion.skeleton.insert_into(this->new_skeleton, algorithm, insert_place);
+            this->solving_step.emplace_back(this->new_skeleton);
+            this->update_fewest_moves();
+            this->solving_step.pop_back();
         }
-        this->solving_step.emplace_back(insertion.skeleton.insert(algorithm, insert_place).first);
-        this->update_fewest_moves();
-        this->solving_step.pop_back();
-    }
+    );
 }
 
 void BruteForceFinder::Worker::update_fewest_moves() {
@@ -2,6 +2,7 @@
 #include <cstring>
 #include <algorithm>
 #include <chrono>
+#include <vector>
 #include <insertionfinder/case.hpp>
 #include <insertionfinder/cube.hpp>
 #include <insertionfinder/insertion.hpp>
@@ -10,6 +11,7 @@ using std::size_t;
 using InsertionFinder::Algorithm;
 using InsertionFinder::Case;
 using InsertionFinder::Cube;
+using InsertionFinder::CubeBatch;
 using InsertionFinder::Finder;
 using InsertionFinder::Insertion;
 using InsertionFinder::Rotation;
@@ -22,6 +24,13 @@ void Finder::init() {
     std::memset(this->edge_cycle_index, 0xff, sizeof(this->edge_cycle_index));
     std::memset(this->center_index, 0xff, sizeof(this->center_index));
 
+    std::vector<Cube> states;
+    states.reserve(this->cases.size());
+    for (const Case& _case: this->cases) {
+        states.push_back(_case.get_state());
+    }
+    this->case_states = CubeBatch(states);
+
     for (size_t index = 0; index < this->cases.size(); ++index) {
         const Case& _case = this->cases[index];
         const Cube& state = _case.get_state();
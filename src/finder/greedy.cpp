@@ -8,6 +8,7 @@
 #include <boost/asio/thread_pool.hpp>
 #include <insertionfinder/cube.hpp>
 #include <insertionfinder/insertion.hpp>
+#include <insertionfinder/skeleton-store.hpp>
 #include <insertionfinder/finder/finder.hpp>
 #include <insertionfinder/finder/greedy.hpp>
 #include "utils.hpp"
@@ -17,6 +18,7 @@ using InsertionFinder::Cube;
 using InsertionFinder::GreedyFinder;
 using InsertionFinder::Insertion;
 using InsertionFinder::Rotation;
+using InsertionFinder::SkeletonStore;
 namespace Details = InsertionFinder::Details;
 namespace FinderStatus = InsertionFinder::FinderStatus;
 
@@ -67,8 +69,11 @@ void GreedyFinder::search_core(const SearchParams& params) {
             this->partial_states[cycles].fewest_moves = skeleton.length();
         }
         this->partial_solution_list[cycles].emplace_back(
-            skeleton,
-            SolvingStep {nullptr, 0, nullptr, false, CycleStatus(parity, corner_cycles, edge_cycles, placement), 0}
+            this->skeleton_store.insert(skeleton).first,
+            SolvingStep {
+                SkeletonStore::none, 0, nullptr, false,
+                CycleStatus(parity, corner_cycles, edge_cycles, placement), 0
+            }
         );
     }
 
@@ -77,14 +82,14 @@ void GreedyFinder::search_core(const SearchParams& params) {
         PartialState& state = this->partial_states[depth];
         solution_list.erase(
             std::remove_if(solution_list.begin(), solution_list.end(), [&state, this](const auto& x) {
-                return x.first.length() > state.fewest_moves + this->options.greedy_threshold;
+                return this->skeleton_store.length(x.first) > state.fewest_moves + this->options.greedy_threshold;
             }),
             solution_list.end()
         );
         std::sort(
             solution_list.begin(), solution_list.end(),
-            [](const auto& x, const auto& y) {
-                if (int comparison = Algorithm::compare(x.first, y.first); comparison < 0) {
+            [this](const auto& x, const auto& y) {
+                if (int comparison = this->skeleton_store.compare(x.first, y.first); comparison < 0) {
                     return true;
                 } else if (comparison > 0) {
                     return false;
@@ -107,51 +112,51 @@ void GreedyFinder::search_core(const SearchParams& params) {
                 << '.' << std::endl;
         }
         boost::asio::thread_pool pool(params.max_threads);
-        for (auto& [skeleton, step]: solution_list) {
-            this->run_worker(pool, std::move(skeleton), step);
+        for (const auto& [skeleton, step]: solution_list) {
+            this->run_worker(pool, skeleton, step);
         }
         pool.join();
     }
 
-    std::vector<const Algorithm*> skeletons;
-    for (auto& [skeleton, step]: this->partial_solution_list[0]) {
-        auto [iter, inserted] = this->partial_solution_map.try_emplace(std::move(skeleton), step);
-        const Algorithm& old_skeleton = iter->first;
+    std::vector<SkeletonStore::Id> skeletons;
+    for (const auto& [skeleton, step]: this->partial_solution_list[0]) {
+        auto [iter, inserted] = this->partial_solution_map.try_emplace(skeleton, step);
         SolvingStep& old_step = iter->second;
         if (inserted) {
-            skeletons.push_back(&old_skeleton);
+            skeletons.push_back(skeleton);
         } else if (step.cancellation < old_step.cancellation) {
             old_step = step;
         }
     }
-    for (const Algorithm* skeleton: skeletons) {
-        const Algorithm* current_skeleton = skeleton;
+    for (SkeletonStore::Id skeleton: skeletons) {
+        SkeletonStore::Id current_id = skeleton;
+        Algorithm current_skeleton = this->skeleton_store[skeleton];
         std::vector<Insertion> result;
         while (std::all_of(
             this->skeletons.cbegin(), this->skeletons.cend(),
-            [&](const auto& x) {return x.first != *current_skeleton;}
+            [&](const auto& x) {return x.first != current_skeleton;}
         )) {
-            const SolvingStep& step = this->partial_solution_map.at(*current_skeleton);
-            current_skeleton = step.skeleton;
-            Algorithm previous_skeleton = *step.skeleton;
+            const SolvingStep& step = this->partial_solution_map.at(current_id);
+            current_id = step.skeleton;
+            current_skeleton = this->skeleton_store[current_id];
+            Algorithm previous_skeleton = current_skeleton;
             if (step.swapped) {
                 previous_skeleton.swap_adjacent(step.insert_place);
             }
             result.emplace_back(std::move(previous_skeleton), step.insert_place, step.insertion);
         }
         std::reverse(result.begin(), result.end());
-        this->solutions.emplace_back(*skeleton, move(result));
+        this->solutions.emplace_back(this->skeleton_store[skeleton], move(result));
     }
 }
 
-void GreedyFinder::run_worker(boost::asio::thread_pool& pool, Algorithm&& skeleton, const SolvingStep& step) {
+void GreedyFinder::run_worker(boost::asio::thread_pool& pool, SkeletonStore::Id skeleton, const SolvingStep& step) {
     std::lock_guard<std::mutex> lock(this->worker_mutex);
-    auto [iter, inserted] = this->partial_solution_map.try_emplace(std::move(skeleton), step);
-    const Algorithm& old_skeleton = iter->first;
+    auto [iter, inserted] = this->partial_solution_map.try_emplace(skeleton, step);
     SolvingStep& old_step = iter->second;
     if (inserted) {
-        boost::asio::post(pool, [&]() {
-            Worker(*this, pool, old_skeleton, old_step.cycle_status, old_step.cancellation).search();
+        boost::asio::post(pool, [&, skeleton]() {
+            Worker(*this, pool, skeleton, old_step.cycle_status, old_step.cancellation).search();
         });
     } else if (step.cancellation < old_step.cancellation) {
         old_step = step;
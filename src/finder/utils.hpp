@@ -1,8 +1,58 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <insertionfinder/algorithm.hpp>
+#include <insertionfinder/case.hpp>
+#include <insertionfinder/cube.hpp>
+#include <insertionfinder/utils.hpp>
 
 namespace InsertionFinder::Details {
     constexpr bool bitcount_less_than_2(std::uint64_t n) {
         return (n & (n - 1)) == 0;
     }
+
+    template<std::byte flags> using TwistFlag = std::integral_constant<std::byte, flags>;
+
+    template<class F> void dispatch_twist_flag(std::byte twist_flag, F&& f) {
+        switch (std::to_integer<int>(twist_flag & CubeTwist::full)) {
+            case 0: f(TwistFlag<std::byte {0}>()); break;
+            case 1: f(TwistFlag<std::byte {1}>()); break;
+            case 2: f(TwistFlag<std::byte {2}>()); break;
+            case 3: f(TwistFlag<std::byte {3}>()); break;
+            case 4: f(TwistFlag<std::byte {4}>()); break;
+            case 5: f(TwistFlag<std::byte {5}>()); break;
+            case 6: f(TwistFlag<std::byte {6}>()); break;
+            default: f(TwistFlag<std::byte {7}>()); break;
+        }
+    }
+
+    // Calls f(algorithm) for each algorithm of the case that inserted into skeleton at insert_place is no longer than
+    // target(). The bitmap is built against the target at the start and target() is read again for every candidate,
+    // as other workers may lower it meanwhile.
+    template<class Target, class F> void for_each_fitting_insertion(
+        const Algorithm& skeleton, const Case& _case, std::size_t insert_place,
+        std::pair<std::uint32_t, std::uint32_t> insert_place_mask, const Target& target, const F& f
+    ) {
+        std::size_t worthy_target = target();
+        InsertionBitmap worthy;
+        skeleton.find_worthy_insertions(
+            _case.get_insertion_masks(), insert_place, insert_place_mask, worthy_target, worthy
+        );
+        for (std::size_t index: BitmapIndices(worthy)) {
+            const InsertionAlgorithm& algorithm = _case.algorithm_list()[index];
+            std::size_t fewest_twists = target();
+            if (
+                (
+                    fewest_twists < worthy_target
+                    && !skeleton.is_worthy_insertion(algorithm, insert_place, insert_place_mask, fewest_twists)
+                )
+                || skeleton.insert_length(algorithm, insert_place, insert_place_mask) > fewest_twists
+            ) {
+                continue;
+            }
+            f(algorithm);
+        }
+    }
 };
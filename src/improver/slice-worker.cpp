@@ -3,9 +3,13 @@
 #include <bitset>
 #include <insertionfinder/algorithm.hpp>
 #include <insertionfinder/cube.hpp>
+#include <insertionfinder/insert-place-table.hpp>
+#include <insertionfinder/skeleton-store.hpp>
 #include <insertionfinder/twist.hpp>
+#include <insertionfinder/utils.hpp>
 #include <insertionfinder/improver/improver.hpp>
 #include <insertionfinder/improver/slice.hpp>
+#include "../finder/utils.hpp"
 using std::size_t;
 using std::uint32_t;
 using std::uint64_t;
@@ -13,9 +17,11 @@ using InsertionFinder::Algorithm;
 using InsertionFinder::Cube;
 using InsertionFinder::InsertionAlgorithm;
 using InsertionFinder::Rotation;
+using InsertionFinder::SkeletonStore;
 using InsertionFinder::SliceImprover;
 using InsertionFinder::Twist;
 namespace CubeTwist = InsertionFinder::CubeTwist;
+namespace Details = InsertionFinder::Details;
 
 
 namespace {
@@ -35,20 +41,20 @@ void SliceImprover::Worker::search() {
             state.twist(this->improver.inverse_skeleton_cube, twist_flag);
         } else {
             Twist twist = this->skeleton[insert_place - 1];
-            state.twist_before(twist.inverse(), twist_flag);
-            state.twist(twist, twist_flag);
+            state.twist_before<twist_flag>(twist.inverse());
+            state.twist<twist_flag>(twist);
         }
         this->try_insertion(insert_place, state);
 
-        if (this->skeleton.swappable(insert_place)) {
+        if (this->place_table.swappable(insert_place)) {
             Twist twist0 = this->skeleton[insert_place - 1];
             Twist twist1 = this->skeleton[insert_place];
             Cube swapped_state;
-            swapped_state.twist(twist0, twist_flag);
-            swapped_state.twist(twist1.inverse(), twist_flag);
-            swapped_state.twist(state, twist_flag);
-            swapped_state.twist(twist1, twist_flag);
-            swapped_state.twist(twist0.inverse(), twist_flag);
+            swapped_state.twist<twist_flag>(twist0);
+            swapped_state.twist<twist_flag>(twist1.inverse());
+            swapped_state.twist<twist_flag>(state);
+            swapped_state.twist<twist_flag>(twist1);
+            swapped_state.twist<twist_flag>(twist0.inverse());
             this->try_insertion(insert_place, swapped_state, true);
         }
     }
@@ -56,11 +62,8 @@ void SliceImprover::Worker::search() {
 
 void SliceImprover::Worker::try_insertion(size_t insert_place, const Cube& state, bool swapped) {
     static constexpr std::byte twist_flag = CubeTwist::edges | CubeTwist::centers;
-    Algorithm skeleton = this->skeleton;
-    if (swapped) {
-        skeleton.swap_adjacent(insert_place);
-    }
-    auto insert_place_mask = skeleton.get_insert_place_mask(insert_place);
+    const Algorithm& skeleton = this->place_table.view(insert_place, swapped);
+    auto insert_place_mask = this->place_table.mask(insert_place, swapped);
 
     for (const Case& _case: this->improver.cases) {
         Cube cube = Cube::twist(state, _case.get_state(), twist_flag, twist_flag);
@@ -68,32 +71,35 @@ void SliceImprover::Worker::try_insertion(size_t insert_place, const Cube& state
         if ((mask & 0xff) || bitcount(mask & 0xfff00) > 4 || bitcount(mask & 0x3f0000) > 4) {
             continue;
         }
-        for (const InsertionAlgorithm& algorithm: _case.algorithm_list()) {
-            size_t target = this->improver.fewest_moves + this->improver.options.threshold;
-            if (!skeleton.is_worthy_insertion(algorithm, insert_place, insert_place_mask, target)) {
-                continue;
-            }
-            Algorithm new_skeleton = skeleton.insert(algorithm, insert_place).first;
-            if (new_skeleton.length() > target) {
-                continue;
-            }
-            new_skeleton.normalize();
-            if (mask == 0) {
-                std::lock_guard<std::mutex> lock(this->improver.fewest_moves_mutex);
-                if (new_skeleton.length() < this->improver.fewest_moves) {
-                    this->improver.fewest_moves = new_skeleton.length();
-                    this->improver.partial_solution_list.clear();
+        auto target = [&]() -> size_t {
+            return this->improver.fewest_moves + this->improver.options.threshold;
+        };
+        Details::for_each_fitting_insertion(
+            skeleton, _case, insert_place, insert_place_mask, target,
+            [&](const InsertionAlgorithm& algorithm) {
+                skeleton.insert_into(this->new_skeleton, algorithm, insert_place);
+                this->new_skeleton.normalize();
+                SkeletonStore::Id new_skeleton_id = this->improver.skeleton_store.insert(
+                    this->new_skeleton, this->skeleton_id, this->skeleton, algorithm.cube_rotation()
+                ).first;
+                if (mask == 0) {
+                    std::lock_guard<std::mutex> lock(this->improver.fewest_moves_mutex);
+                    if (this->new_skeleton.length() < this->improver.fewest_moves) {
+                        this->improver.fewest_moves = this->new_skeleton.length();
+                        this->improver.partial_solution_list.clear();
+                    }
+                    this->improver.partial_solution_list.insert(new_skeleton_id);
                 }
-                this->improver.partial_solution_list.insert(new_skeleton);
+                this->improver.run_worker(
+                    this->pool,
+                    new_skeleton_id,
+                    SolvingStep {
+                        this->skeleton_id, insert_place, &algorithm, swapped, cube.placement(),
+                        this->cancellation + this->skeleton.length() + algorithm.length()
+                            - this->new_skeleton.length()
+                    }
+                );
             }
-            this->improver.run_worker(
-                this->pool,
-                std::move(new_skeleton),
-                SolvingStep {
-                    &this->skeleton, insert_place, &algorithm, swapped, cube.placement(),
-                    this->cancellation + this->skeleton.length() + algorithm.length() - new_skeleton.length()
-                }
-            );
-        }
+        );
     }
 }
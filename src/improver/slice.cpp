@@ -3,44 +3,45 @@
 #include <utility>
 #include <vector>
 #include <boost/asio/thread_pool.hpp>
+#include <insertionfinder/skeleton-store.hpp>
 #include <insertionfinder/improver/improver.hpp>
 #include <insertionfinder/improver/slice.hpp>
 using InsertionFinder::Algorithm;
 using InsertionFinder::Insertion;
+using InsertionFinder::SkeletonStore;
 using InsertionFinder::SliceImprover;
 
 
 void SliceImprover::search_core(const SearchParams& params) {
-    this->partial_solution_list.insert(this->skeleton);
+    SkeletonStore::Id root = this->skeleton_store.insert(this->skeleton).first;
+    this->partial_solution_list.insert(root);
     boost::asio::thread_pool pool(params.max_threads);
-    this->run_worker(pool, Algorithm(this->skeleton), SolvingStep {nullptr, 0, nullptr, false, 0, 0});
+    this->run_worker(pool, root, SolvingStep {SkeletonStore::none, 0, nullptr, false, 0, 0});
     pool.join();
 
-    for (const Algorithm& algorithm: this->partial_solution_list) {
+    for (SkeletonStore::Id skeleton: this->partial_solution_list) {
         std::vector<Insertion> result;
-        const Algorithm* current_skeleton = &algorithm;
-        while (*current_skeleton != this->skeleton) {
-            const SolvingStep& step = this->partial_solution_map.at(*current_skeleton);
+        for (SkeletonStore::Id current_skeleton = skeleton; current_skeleton != root;) {
+            const SolvingStep& step = this->partial_solution_map.at(current_skeleton);
             current_skeleton = step.skeleton;
-            Algorithm previous_skeleton = *step.skeleton;
+            Algorithm previous_skeleton = this->skeleton_store[step.skeleton];
             if (step.swapped) {
                 previous_skeleton.swap_adjacent(step.insert_place);
             }
             result.emplace_back(std::move(previous_skeleton), step.insert_place, step.insertion);
         }
         std::reverse(result.begin(), result.end());
-        this->solutions.emplace_back(algorithm, move(result));
+        this->solutions.emplace_back(this->skeleton_store[skeleton], move(result));
     }
 }
 
-void SliceImprover::run_worker(boost::asio::thread_pool& pool, Algorithm&& skeleton, const SolvingStep& step) {
+void SliceImprover::run_worker(boost::asio::thread_pool& pool, SkeletonStore::Id skeleton, const SolvingStep& step) {
     std::lock_guard<std::mutex> lock(this->worker_mutex);
-    auto [iter, inserted] = this->partial_solution_map.try_emplace(std::move(skeleton), step);
-    const Algorithm& old_skeleton = iter->first;
+    auto [iter, inserted] = this->partial_solution_map.try_emplace(skeleton, step);
     SolvingStep& old_step = iter->second;
     if (inserted) {
-        boost::asio::post(pool, [&]() {
-            Worker(*this, pool, old_skeleton, old_step.placement, old_step.cancellation).search();
+        boost::asio::post(pool, [&, skeleton]() {
+            Worker(*this, pool, skeleton, old_step.placement, old_step.cancellation).search();
         });
     } else if (step.cancellation < old_step.cancellation) {
         old_step = step;
@@ -1,4 +1,5 @@
 #include <cstddef>
+#include <cstdint>
 #include <array>
 #include <ostream>
 #include <string>
@@ -19,17 +20,15 @@ namespace {
 };
 
 
-const std::array<std::array<int, 24>, 24> Rotation::rotation_transform = generate_rotation_transform_table();
-
-std::array<std::array<int, 24>, 24> Rotation::generate_rotation_transform_table() noexcept {
-    static const auto& table = Rotation::rotation_permutation;
-    std::array<std::array<int, 24>, 24> center_transform;
+constexpr std::array<std::array<std::uint8_t, 24>, 24> Rotation::generate_rotation_transform_table() noexcept {
+    const auto& table = Rotation::rotation_permutation;
+    std::array<std::array<std::uint8_t, 24>, 24> center_transform {};
     for (size_t i = 0; i < 24; ++i) {
         for (size_t j = 0; j < 24; ++j) {
             int x = table[i][0];
-            Rotation center0 = table[j][x >> 1] ^ (x & 1);
+            int center0 = table[j][x >> 1] ^ (x & 1);
             int y = table[i][1];
-            Rotation center1 = table[j][y >> 1] ^ (y & 1);
+            int center1 = table[j][y >> 1] ^ (y & 1);
             for (int k = 0; k < 24; ++k) {
                 if (center0 == table[k][0] && center1 == table[k][1]) {
                     center_transform[i][j] = k;
@@ -41,6 +40,9 @@ std::array<std::array<int, 24>, 24> Rotation::generate_rotation_transform_table(
     return center_transform;
 }
 
+constexpr std::array<std::array<std::uint8_t, 24>, 24> Rotation::rotation_transform =
+    Rotation::generate_rotation_transform_table();
+
 
 std::ostream& operator<<(std::ostream& out, Rotation rotation) {
     return out << rotation_string[rotation.rotation];
@@ -1,7 +1,528 @@
 #define BOOST_TEST_MODULE algorithm
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 #include <boost/test/unit_test.hpp>
 #include <insertionfinder/algorithm.hpp>
+#include <insertionfinder/insert-place-table.hpp>
+#include <insertionfinder/skeleton-store.hpp>
+#include <insertionfinder/small-vector.hpp>
+#include <insertionfinder/utils.hpp>
+using std::size_t;
+using InsertionFinder::Algorithm;
+using InsertionFinder::AlgorithmError;
+using InsertionFinder::InsertionAlgorithm;
+using InsertionFinder::InsertionBitmap;
+using InsertionFinder::InsertionMaskList;
+using InsertionFinder::InsertPlaceTable;
+using InsertionFinder::Rotation;
+using InsertionFinder::SkeletonStore;
+using InsertionFinder::Twist;
+using InsertionFinder::operator""_alg;
+namespace Details = InsertionFinder::Details;
+
+namespace {
+    Algorithm random_algorithm(std::mt19937& generator, size_t length) {
+        std::uniform_int_distribution<unsigned> twist_distribution(0, 23);
+        Algorithm algorithm;
+        for (; length; --length) {
+            if (Twist twist = twist_distribution(generator); twist & 3) {
+                algorithm += twist;
+            }
+        }
+        return algorithm;
+    }
+
+    // Builds an insertion the way insert did before it cancelled around the splice only: the three parts are
+    // concatenated and cancelled as a whole, and the returned index is the first place where a move cancelled,
+    // capped at insert_place + 1.
+    std::pair<Algorithm, size_t> reference_insert(
+        const Algorithm& skeleton, const Algorithm& insertion, size_t insert_place
+    ) {
+        std::vector<Twist> twists;
+        for (size_t index = 0; index < insert_place; ++index) {
+            twists.push_back(skeleton[index]);
+        }
+        for (size_t index = 0; index < insertion.length(); ++index) {
+            twists.push_back(insertion[index]);
+        }
+        for (size_t index = insert_place; index < skeleton.length(); ++index) {
+            twists.push_back(skeleton[index] / insertion.cube_rotation());
+        }
+        std::ptrdiff_t p = -1;
+        size_t needle = twists.size();
+        for (size_t q = 0; q < twists.size(); ++q) {
+            if (p < 0 || twists[p] >> 3 != twists[q] >> 3) {
+                twists[++p] = twists[q];
+            } else if (twists[p] >> 2 != twists[q] >> 2) {
+                if (p > 0 && twists[p - 1] >> 3 == twists[p] >> 3) {
+                    needle = std::min<size_t>(needle, p);
+                    if (unsigned orientation = (twists[p - 1] + twists[q]) & 3; orientation == 0) {
+                        twists[p - 1] = twists[p];
+                        --p;
+                    } else {
+                        twists[p - 1] = (twists[p - 1] & ~3) | orientation;
+                    }
+                } else {
+                    twists[++p] = twists[q];
+                }
+            } else {
+                if (unsigned orientation = (twists[p] + twists[q]) & 3; orientation == 0) {
+                    --p;
+                } else {
+                    twists[p] = (twists[p] & ~3) | orientation;
+                }
+                needle = std::min<size_t>(needle, p + 1);
+            }
+        }
+        Algorithm result;
+        for (std::ptrdiff_t index = 0; index <= p; ++index) {
+            result += twists[index];
+        }
+        return {result, std::min(needle, insert_place + 1)};
+    }
+
+    void check_insert_into(const Algorithm& skeleton, const Algorithm& insertion, size_t insert_place) {
+        auto [expected, expected_place] = reference_insert(skeleton, insertion, insert_place);
+        Algorithm result;
+        size_t place = skeleton.insert_into(result, insertion, insert_place);
+        BOOST_TEST_REQUIRE(place == expected_place);
+        BOOST_TEST_REQUIRE(result.length() == expected.length());
+        for (size_t index = 0; index < expected.length(); ++index) {
+            BOOST_TEST_REQUIRE(result[index] == expected[index]);
+        }
+        BOOST_TEST_REQUIRE(std::hash<Algorithm>()(result) == std::hash<Algorithm>()(expected));
+    }
+};
 
 BOOST_AUTO_TEST_CASE(test) {
     BOOST_TEST(true);
 }
+
+
+namespace {
+    std::optional<Algorithm> reference_parse(const std::string& string) {
+        static const std::regex twists_regex(R"(\s*([UDRLFBxyz][2']?)\s*)");
+        static const std::pair<std::string, Rotation> rotations[9] = {
+            {"x", 12}, {"x2", 8}, {"x'", 4},
+            {"y", 3}, {"y2", 2}, {"y'", 1},
+            {"z", 20}, {"z2", 10}, {"z'", 16}
+        };
+        Algorithm algorithm;
+        Rotation rotation = 0;
+        std::smatch match_result;
+        auto begin = string.cbegin();
+        while (std::regex_search(begin, string.cend(), match_result, twists_regex)) {
+            if (match_result.position()) {
+                return std::nullopt;
+            }
+            const std::string match_string = match_result.str(1);
+            auto pattern = std::find_if(
+                std::begin(rotations), std::end(rotations),
+                [&](const auto& pattern) {return pattern.first == match_string;}
+            );
+            if (pattern == std::end(rotations)) {
+                algorithm += Twist(match_string) * rotation / algorithm.cube_rotation();
+            } else {
+                rotation = pattern->second * rotation;
+            }
+            begin += match_result.length();
+        }
+        if (begin != string.cend()) {
+            return std::nullopt;
+        }
+        return algorithm + rotation.inverse();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(algorithm_parse) {
+    BOOST_TEST(Algorithm("").length() == 0);
+    BOOST_TEST(Algorithm("R U R' U'").str() == "R U R' U'");
+    BOOST_TEST(Algorithm(" RUR'U' ").str() == "R U R' U'");
+    BOOST_TEST(Algorithm("x R y2").str() == "R x y2");
+    BOOST_CHECK_THROW(Algorithm(" "), AlgorithmError);
+    BOOST_CHECK_THROW(Algorithm("R2'"), AlgorithmError);
+    BOOST_CHECK_THROW(Algorithm("R u"), AlgorithmError);
+
+    std::mt19937 generator(2019);
+    const std::string alphabet = "UDRLFBxyz2' \t\n'2UDRLFBxyz?";
+    std::uniform_int_distribution<size_t> length_distribution(0, 12);
+    std::uniform_int_distribution<size_t> char_distribution(0, alphabet.size() - 1);
+    for (size_t i = 0; i < 20000; ++i) {
+        std::string string;
+        for (size_t length = length_distribution(generator); length; --length) {
+            string += alphabet[char_distribution(generator)];
+        }
+        std::optional<Algorithm> expected = reference_parse(string);
+        if (expected) {
+            BOOST_TEST_REQUIRE((Algorithm(string) == *expected), string);
+        } else {
+            BOOST_CHECK_THROW(Algorithm algorithm(string), AlgorithmError);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(algorithm_beyond_inline_capacity) {
+    const std::string sexy = "R U R' U' ";
+    std::string string;
+    for (size_t length = 0; length < 3 * Algorithm::inline_capacity; length += 4) {
+        Algorithm algorithm(string);
+        BOOST_TEST_REQUIRE(algorithm.length() == length);
+        BOOST_TEST_REQUIRE(algorithm.str() + (length ? " " : "") == string);
+
+        Algorithm copy = algorithm;
+        BOOST_TEST_REQUIRE((copy == algorithm));
+        Algorithm moved = std::move(copy);
+        BOOST_TEST_REQUIRE((moved == algorithm));
+        copy = moved + "F"_alg;
+        BOOST_TEST_REQUIRE(copy.length() == length + 1);
+        BOOST_TEST_REQUIRE((copy != algorithm));
+        copy = algorithm;
+        BOOST_TEST_REQUIRE((copy == algorithm));
+
+        Algorithm inverse = Algorithm::inverse(algorithm);
+        inverse.inverse();
+        BOOST_TEST_REQUIRE((inverse == algorithm));
+
+        auto [result, place] = algorithm.insert("F R U R' U' F'"_alg, length / 2);
+        BOOST_TEST_REQUIRE(result.length() == length + 6);
+        BOOST_TEST_REQUIRE(place == length / 2 + 1);
+
+        std::stringstream stream;
+        algorithm.save_to(stream);
+        Algorithm loaded;
+        loaded.read_from(stream);
+        BOOST_TEST_REQUIRE((loaded == algorithm));
+        string += sexy;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(small_vector_insert_own_range) {
+    for (size_t length: {4, 8, 12}) {
+        for (size_t position = 0; position <= length; ++position) {
+            for (size_t first = 0; first < length; ++first) {
+                for (size_t last = first; last <= length; ++last) {
+                    Details::SmallVector<int, 16> vector;
+                    std::vector<int> expected;
+                    for (size_t index = 0; index < length; ++index) {
+                        vector.push_back(index);
+                        expected.push_back(index);
+                    }
+                    std::vector<int> range(expected.cbegin() + first, expected.cbegin() + last);
+                    vector.insert(vector.cbegin() + position, vector.cbegin() + first, vector.cbegin() + last);
+                    expected.insert(expected.cbegin() + position, range.cbegin(), range.cend());
+                    BOOST_TEST_REQUIRE(std::equal(vector.cbegin(), vector.cend(), expected.cbegin(), expected.cend()));
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(algorithm_insert_into) {
+    std::mt19937 generator(2019);
+    std::uniform_int_distribution<unsigned> rotation_distribution(0, 23);
+    Algorithm result;
+    for (size_t i = 0; i < 10000; ++i) {
+        Algorithm skeleton = random_algorithm(generator, i % 100);
+        skeleton.simplify();
+        skeleton.normalize();
+        const Algorithm insertion = random_algorithm(generator, i % 20) + Rotation(rotation_distribution(generator));
+        InsertionAlgorithm insertion_algorithm;
+        if (insertion.length()) {
+            std::stringstream stream;
+            Algorithm algorithm = insertion;
+            if (i % 2) {
+                algorithm.simplify();
+                algorithm += insertion.cube_rotation();
+            }
+            algorithm.save_to(stream);
+            insertion_algorithm.read_from(stream);
+        }
+        for (size_t insert_place = 0; insert_place <= skeleton.length(); ++insert_place) {
+            Algorithm expected;
+            for (size_t index = 0; index < insert_place; ++index) {
+                expected += skeleton[index];
+            }
+            expected += insertion;
+            for (size_t index = insert_place; index < skeleton.length(); ++index) {
+                expected += skeleton[index];
+            }
+            expected.simplify();
+            skeleton.insert_into(result, insertion, insert_place);
+            BOOST_TEST_REQUIRE((result == expected));
+            check_insert_into(skeleton, insertion, insert_place);
+            BOOST_TEST_REQUIRE(skeleton.insert_length(insertion, insert_place) == expected.length());
+            if (insertion_algorithm.length()) {
+                auto insert_place_mask = skeleton.get_insert_place_mask(insert_place);
+                BOOST_TEST_REQUIRE(
+                    skeleton.insert_length(insertion_algorithm, insert_place, insert_place_mask)
+                    == skeleton.insert(insertion_algorithm, insert_place).first.length()
+                );
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(algorithm_insert_into_unsimplified) {
+    BOOST_TEST(Algorithm("U R R").insert("F"_alg, 0).first.str() == "F U R2");
+    BOOST_TEST(Algorithm("U R R").insert("F"_alg, 3).first.str() == "U R2 F");
+    BOOST_TEST(Algorithm("U R R").insert_length("F"_alg, 0) == 3);
+
+    std::mt19937 generator(2019);
+    std::uniform_int_distribution<unsigned> rotation_distribution(0, 23);
+    Algorithm result;
+    for (size_t i = 0; i < 2000; ++i) {
+        const Algorithm skeleton = random_algorithm(generator, i % 40);
+        const Algorithm insertion = random_algorithm(generator, i % 10) + Rotation(rotation_distribution(generator));
+        const InsertionAlgorithm insertion_algorithm = insertion;
+        for (size_t insert_place = 0; insert_place <= skeleton.length(); ++insert_place) {
+            Algorithm expected;
+            for (size_t index = 0; index < insert_place; ++index) {
+                expected += skeleton[index];
+            }
+            expected += insertion;
+            for (size_t index = insert_place; index < skeleton.length(); ++index) {
+                expected += skeleton[index];
+            }
+            expected.simplify();
+            skeleton.insert_into(result, insertion, insert_place);
+            BOOST_TEST_REQUIRE((result == expected));
+            check_insert_into(skeleton, insertion, insert_place);
+            BOOST_TEST_REQUIRE(skeleton.insert_length(insertion, insert_place) == expected.length());
+            BOOST_TEST_REQUIRE(
+                skeleton.insert_length(insertion_algorithm, insert_place, skeleton.get_insert_place_mask(insert_place))
+                == expected.length()
+            );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(algorithm_cached_hash) {
+    auto reference_hash = [](const Algorithm& algorithm) {
+        size_t result = algorithm.cube_rotation();
+        for (size_t index = 0; index < algorithm.length(); ++index) {
+            result = result * 31 + algorithm[index];
+        }
+        return result;
+    };
+    std::hash<Algorithm> hash;
+    std::mt19937 generator(2019);
+    std::uniform_int_distribution<unsigned> rotation_distribution(0, 23);
+    for (size_t i = 0; i < 1000; ++i) {
+        Algorithm algorithm = random_algorithm(generator, i % 300);
+        algorithm += Rotation(rotation_distribution(generator));
+        BOOST_TEST_REQUIRE(hash(algorithm) == reference_hash(algorithm));
+        BOOST_TEST_REQUIRE(hash(Algorithm(algorithm.str())) == reference_hash(algorithm));
+        std::stringstream stream;
+        algorithm.save_to(stream);
+        Algorithm loaded;
+        loaded.read_from(stream);
+        BOOST_TEST_REQUIRE(hash(loaded) == reference_hash(loaded));
+        for (size_t place = 1; place < algorithm.length(); ++place) {
+            if (algorithm.swappable(place)) {
+                algorithm.swap_adjacent(place);
+                BOOST_TEST_REQUIRE(hash(algorithm) == reference_hash(algorithm));
+            }
+        }
+        algorithm.rotate(rotation_distribution(generator));
+        BOOST_TEST_REQUIRE(hash(algorithm) == reference_hash(algorithm));
+        const Algorithm inverse = Algorithm::inverse(algorithm);
+        BOOST_TEST_REQUIRE(hash(inverse) == reference_hash(inverse));
+        algorithm.inverse();
+        BOOST_TEST_REQUIRE((algorithm == inverse));
+        BOOST_TEST_REQUIRE(hash(algorithm) == reference_hash(algorithm));
+        const Algorithm sum = algorithm + inverse;
+        BOOST_TEST_REQUIRE(hash(sum) == reference_hash(sum));
+        algorithm += inverse;
+        BOOST_TEST_REQUIRE(hash(algorithm) == reference_hash(algorithm));
+        algorithm.simplify();
+        BOOST_TEST_REQUIRE(hash(algorithm) == reference_hash(algorithm));
+        algorithm.normalize();
+        BOOST_TEST_REQUIRE(hash(algorithm) == reference_hash(algorithm));
+        auto [result, place] = algorithm.insert("R U R' U'"_alg + Rotation(3), algorithm.length() / 2);
+        BOOST_TEST_REQUIRE(hash(result) == reference_hash(result));
+        auto marked = std::get<0>(algorithm.insert_return_marks("R U R' U'"_alg, algorithm.length() / 2));
+        BOOST_TEST_REQUIRE(hash(marked) == reference_hash(marked));
+        if (algorithm.length() < 20) {
+            for (const Algorithm& similar: algorithm.generate_similars()) {
+                BOOST_TEST_REQUIRE(hash(similar) == reference_hash(similar));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(skeleton_store_interning) {
+    std::mt19937 generator(2019);
+    std::uniform_int_distribution<unsigned> rotation_distribution(0, 23);
+    std::uniform_int_distribution<size_t> length_distribution(0, 6);
+    SkeletonStore store;
+    std::vector<Algorithm> algorithms;
+    std::vector<SkeletonStore::Id> ids;
+    for (size_t i = 0; i < 100000; ++i) {
+        Algorithm algorithm = random_algorithm(generator, i % 1000 == 0 ? 600 : length_distribution(generator));
+        algorithm += Rotation(rotation_distribution(generator) % 2);
+        auto [id, inserted] = store.insert(algorithm);
+        BOOST_TEST_REQUIRE(inserted == (id == algorithms.size()));
+        if (inserted) {
+            algorithms.push_back(algorithm);
+        }
+        BOOST_TEST_REQUIRE((store[id] == algorithm));
+        BOOST_TEST_REQUIRE(store.length(id) == algorithm.length());
+        BOOST_TEST_REQUIRE(store.hash(id) == std::hash<Algorithm>()(algorithm));
+        ids.push_back(id);
+    }
+    BOOST_TEST(algorithms.size() < ids.size());
+    for (size_t i = 1; i < ids.size(); ++i) {
+        int expected = Algorithm::compare(algorithms[ids[i - 1]], algorithms[ids[i]]);
+        int result = store.compare(ids[i - 1], ids[i]);
+        BOOST_TEST_REQUIRE(((expected < 0) == (result < 0) && (expected > 0) == (result > 0)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(skeleton_store_many_blocks) {
+    constexpr Twist twists[] = {1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, 17, 18, 19, 21, 22, 23};
+    auto make_algorithm = [&](size_t index) {
+        Algorithm algorithm;
+        for (; index; index /= 18) {
+            algorithm += twists[index % 18];
+        }
+        return algorithm;
+    };
+    SkeletonStore store;
+    constexpr size_t count = 300000;
+    for (size_t index = 0; index < count; ++index) {
+        auto [id, inserted] = store.insert(make_algorithm(index));
+        BOOST_TEST_REQUIRE(inserted);
+        BOOST_TEST_REQUIRE(id == index);
+    }
+    for (size_t index = 0; index < count; index += 97) {
+        Algorithm algorithm = make_algorithm(index);
+        BOOST_TEST_REQUIRE((store[index] == algorithm));
+        BOOST_TEST_REQUIRE(store.insert(algorithm).first == index);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(skeleton_store_derived_skeletons) {
+    std::mt19937 generator(2019);
+    std::uniform_int_distribution<unsigned> rotation_distribution(0, 23);
+    SkeletonStore store;
+    std::vector<Algorithm> algorithms;
+    for (size_t i = 0; i < 200; ++i) {
+        Algorithm skeleton = random_algorithm(generator, i % 120);
+        skeleton.simplify();
+        auto [id, inserted] = store.insert(skeleton);
+        for (size_t depth = 0; depth < 20; ++depth) {
+            Algorithm insertion = random_algorithm(generator, 8);
+            insertion.simplify();
+            insertion += Rotation(rotation_distribution(generator) % 4);
+            std::uniform_int_distribution<size_t> place_distribution(0, skeleton.length());
+            size_t insert_place = place_distribution(generator);
+            Algorithm parent = skeleton;
+            if (depth % 3 == 0 && parent.swappable(insert_place)) {
+                parent.swap_adjacent(insert_place);
+            }
+            Algorithm child = parent.insert(insertion, insert_place).first;
+            child.normalize();
+            auto [child_id, child_inserted] = store.insert(child, id, skeleton, insertion.cube_rotation());
+            BOOST_TEST_REQUIRE((store[child_id] == child));
+            BOOST_TEST_REQUIRE(store.length(child_id) == child.length());
+            BOOST_TEST_REQUIRE(store.insert(child).first == child_id);
+            int expected = Algorithm::compare(child, skeleton);
+            int result = store.compare(child_id, id);
+            BOOST_TEST_REQUIRE(((expected < 0) == (result < 0) && (expected > 0) == (result > 0)));
+            algorithms.push_back(child);
+            skeleton = std::move(child);
+            id = child_id;
+        }
+    }
+    std::vector<SkeletonStore::Id> ids;
+    for (const Algorithm& algorithm: algorithms) {
+        auto [id, inserted] = store.insert(algorithm);
+        BOOST_TEST_REQUIRE(!inserted);
+        BOOST_TEST_REQUIRE((store[id] == algorithm));
+        ids.push_back(id);
+    }
+    std::uniform_int_distribution<size_t> index_distribution(0, ids.size() - 1);
+    for (size_t i = 0; i < 10000; ++i) {
+        size_t x = index_distribution(generator);
+        size_t y = index_distribution(generator);
+        int expected = Algorithm::compare(algorithms[x], algorithms[y]);
+        int result = store.compare(ids[x], ids[y]);
+        BOOST_TEST_REQUIRE(((expected < 0) == (result < 0) && (expected > 0) == (result > 0)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(insert_place_table) {
+    std::mt19937 generator(2019);
+    for (size_t i = 0; i < 1000; ++i) {
+        Algorithm skeleton = random_algorithm(generator, i % 100);
+        skeleton.simplify();
+        skeleton.normalize();
+        InsertPlaceTable table(skeleton);
+        for (size_t pass = 0; pass < 2; ++pass) {
+            for (size_t insert_place = 0; insert_place <= skeleton.length(); ++insert_place) {
+                BOOST_TEST_REQUIRE(table.swappable(insert_place) == skeleton.swappable(insert_place));
+                BOOST_TEST_REQUIRE((table.mask(insert_place, false) == skeleton.get_insert_place_mask(insert_place)));
+                BOOST_TEST_REQUIRE((table.view(insert_place, false) == skeleton));
+                if (skeleton.swappable(insert_place)) {
+                    Algorithm swapped = skeleton;
+                    swapped.swap_adjacent(insert_place);
+                    BOOST_TEST_REQUIRE((table.mask(insert_place, true) == swapped.get_insert_place_mask(insert_place)));
+                    BOOST_TEST_REQUIRE((table.view(insert_place, true) == swapped));
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(find_worthy_insertions) {
+    std::mt19937 generator(2019);
+    auto random_simplified_algorithm = [&](size_t length) {
+        Algorithm algorithm = random_algorithm(generator, length);
+        algorithm.simplify();
+        algorithm.normalize();
+        return algorithm;
+    };
+    std::vector<InsertionAlgorithm> insertions;
+    InsertionMaskList insertion_masks;
+    for (size_t i = 0; i < 203; ++i) {
+        insertions.emplace_back(random_simplified_algorithm(i % 17));
+        insertion_masks.push_back(insertions.back());
+    }
+    BOOST_TEST_REQUIRE(insertion_masks.size() == insertions.size());
+    InsertionBitmap bitmap;
+    for (size_t i = 0; i < 100; ++i) {
+        Algorithm skeleton = random_simplified_algorithm(i % 40);
+        const size_t length = skeleton.length();
+        const size_t targets[] = {
+            std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max() - 1,
+            0, length / 2, length, length + 4, length + 8, length + 16
+        };
+        for (size_t insert_place = 0; insert_place <= length; ++insert_place) {
+            auto insert_place_mask = skeleton.get_insert_place_mask(insert_place);
+            for (size_t target: targets) {
+                skeleton.find_worthy_insertions(insertion_masks, insert_place, insert_place_mask, target, bitmap);
+                std::vector<size_t> expected;
+                for (size_t index = 0; index < insertions.size(); ++index) {
+                    if (skeleton.is_worthy_insertion(insertions[index], insert_place, insert_place_mask, target)) {
+                        expected.push_back(index);
+                    }
+                }
+                std::vector<size_t> actual;
+                for (size_t index: Details::BitmapIndices(bitmap)) {
+                    actual.push_back(index);
+                }
+                BOOST_TEST_REQUIRE(actual == expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <insertionfinder/algorithm.hpp>
+#include <insertionfinder/case.hpp>
+#include <insertionfinder/case-file.hpp>
+#include <insertionfinder/cube.hpp>
+#include <insertionfinder/twist.hpp>
+using std::size_t;
+using InsertionFinder::Algorithm;
+using InsertionFinder::Case;
+using InsertionFinder::CaseFile;
+using InsertionFinder::CaseStreamError;
+using InsertionFinder::Cube;
+using InsertionFinder::InsertionAlgorithm;
+using InsertionFinder::Rotation;
+using InsertionFinder::Twist;
+
+
+namespace {
+    std::vector<Case> random_cases(size_t count) {
+        std::mt19937 generator(2019);
+        std::uniform_int_distribution<unsigned> twist_distribution(0, 23);
+        std::uniform_int_distribution<unsigned> rotation_distribution(0, 23);
+        std::vector<Case> cases;
+        for (size_t i = 0; i < count; ++i) {
+            Algorithm algorithm;
+            for (size_t length = i % 13 + 1; length; --length) {
+                if (Twist twist = twist_distribution(generator); twist & 3) {
+                    algorithm += twist;
+                }
+            }
+            algorithm += Rotation(rotation_distribution(generator));
+            algorithm.simplify();
+            algorithm.normalize();
+            Case _case(Cube() * algorithm);
+            for (const Algorithm& similar: algorithm.generate_symmetrics()) {
+                _case.add_algorithm(similar);
+            }
+            _case.sort_algorithms();
+            cases.push_back(std::move(_case));
+        }
+        return cases;
+    }
+
+    void save_cases(const std::string& path, const std::vector<Case>& cases, int version) {
+        std::ofstream fout(path, std::ios::out | std::ios::binary);
+        CaseFile::save_to(fout, cases, version);
+    }
+};
+
+
+BOOST_AUTO_TEST_CASE(case_file_round_trip) {
+    const std::vector<Case> cases = random_cases(50);
+    const std::string path = "case-file-round-trip.algs";
+    for (int version: {1, 2}) {
+        save_cases(path, cases, version);
+        CaseFile file(path);
+        BOOST_TEST_REQUIRE(!file.fail());
+        BOOST_TEST(file.version() == version);
+        save_cases(path + ".copy", cases, version);
+        BOOST_TEST(CaseFile(path + ".copy").content_hash() == file.content_hash());
+        std::vector<Case> loaded;
+        file.read_cases(loaded);
+        BOOST_TEST_REQUIRE(loaded.size() == cases.size());
+        for (size_t i = 0; i < cases.size(); ++i) {
+            const Case& expected = cases[i];
+            const Case& actual = loaded[i];
+            BOOST_TEST_REQUIRE((actual == expected));
+            BOOST_TEST(actual.get_mask() == expected.get_mask());
+            BOOST_TEST(actual.has_parity() == expected.has_parity());
+            BOOST_TEST(actual.get_corner_cycles() == expected.get_corner_cycles());
+            BOOST_TEST(actual.get_edge_cycles() == expected.get_edge_cycles());
+            BOOST_TEST_REQUIRE(actual.algorithm_list().size() == expected.algorithm_list().size());
+            BOOST_TEST(actual.get_insertion_masks().size() == expected.algorithm_list().size());
+            Algorithm skeleton("R U R' U'");
+            for (size_t j = 0; j < expected.algorithm_list().size(); ++j) {
+                const InsertionAlgorithm& algorithm = actual.algorithm_list()[j];
+                BOOST_TEST_REQUIRE((algorithm == expected.algorithm_list()[j]));
+                BOOST_TEST(std::hash<Algorithm>()(algorithm) == std::hash<Algorithm>()(expected.algorithm_list()[j]));
+                for (size_t place = 0; place <= skeleton.length(); ++place) {
+                    auto mask = skeleton.get_insert_place_mask(place);
+                    BOOST_TEST(
+                        skeleton.is_worthy_insertion(algorithm, place, mask)
+                        == skeleton.is_worthy_insertion(expected.algorithm_list()[j], place, mask)
+                    );
+                }
+            }
+        }
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".copy").c_str());
+}
+
+BOOST_AUTO_TEST_CASE(case_file_invalid) {
+    BOOST_TEST(CaseFile("case-file-missing.algs").fail());
+    const std::vector<Case> cases = random_cases(10);
+    const std::string path = "case-file-invalid.algs";
+    for (int version: {1, 2}) {
+        save_cases(path, cases, version);
+        save_cases(path + ".complete", cases, version);
+        std::string data;
+        {
+            std::ifstream fin(path, std::ios::in | std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+        }
+        {
+            std::ofstream fout(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            fout.write(data.data(), data.size() - 1);
+        }
+        CaseFile file(path);
+        BOOST_TEST_REQUIRE(!file.fail());
+        BOOST_TEST(file.content_hash() != CaseFile(path + ".complete").content_hash());
+        std::vector<Case> loaded;
+        BOOST_CHECK_THROW(file.read_cases(loaded), CaseStreamError);
+        BOOST_TEST(loaded.size() < cases.size());
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".complete").c_str());
+}
+
+BOOST_AUTO_TEST_CASE(case_file_writer) {
+    const std::vector<Case> cases = random_cases(50);
+    for (int version: {1, 2}) {
+        std::ostringstream expected;
+        CaseFile::save_to(expected, cases, version);
+        std::ostringstream actual;
+        CaseFile::Writer writer("case-file-writer", version);
+        for (const Case& _case: cases) {
+            writer.write(_case);
+        }
+        writer.finish(actual);
+        BOOST_TEST((actual.str() == expected.str()));
+    }
+    BOOST_CHECK_THROW(CaseFile::Writer("case-file-writer", 3), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(case_algorithm_dedup) {
+    std::mt19937 generator(2019);
+    std::uniform_int_distribution<unsigned> twist_distribution(0, 23);
+    std::uniform_int_distribution<unsigned> rotation_distribution(0, 3);
+    std::vector<Algorithm> pool;
+    for (size_t i = 0; i < 300; ++i) {
+        Algorithm algorithm;
+        for (size_t length = i % 5 + 1; length; --length) {
+            if (Twist twist = twist_distribution(generator); twist & 3) {
+                algorithm += twist;
+            }
+        }
+        pool.push_back(algorithm + Rotation(rotation_distribution(generator)));
+    }
+    auto add_reference = [](std::vector<Algorithm>& reference, const Algorithm& algorithm) {
+        if (std::find(reference.cbegin(), reference.cend(), algorithm) == reference.cend()) {
+            reference.push_back(algorithm);
+        }
+    };
+    std::uniform_int_distribution<size_t> pool_distribution(0, pool.size() - 1);
+    Case _case;
+    Case other;
+    std::vector<Algorithm> expected;
+    std::vector<Algorithm> other_expected;
+    for (size_t i = 0; i < 2000; ++i) {
+        const Algorithm& algorithm = pool[pool_distribution(generator)];
+        if (i & 1) {
+            _case.add_algorithm(algorithm);
+            add_reference(expected, algorithm);
+        } else {
+            other.add_algorithm(algorithm);
+            add_reference(other_expected, algorithm);
+        }
+        if (i % 300 == 0) {
+            _case.merge_algorithms(std::move(other));
+            for (const Algorithm& algorithm: other_expected) {
+                add_reference(expected, algorithm);
+            }
+            other = Case();
+            other_expected.clear();
+        }
+    }
+    BOOST_TEST_REQUIRE(_case.algorithm_list().size() == expected.size());
+    BOOST_TEST_REQUIRE(_case.get_insertion_masks().size() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        BOOST_TEST_REQUIRE((_case.algorithm_list()[i] == expected[i]));
+    }
+    _case.sort_algorithms();
+    for (const Algorithm& algorithm: pool) {
+        BOOST_TEST(
+            _case.contains_algorithm(algorithm)
+            == (std::find(expected.cbegin(), expected.cend(), algorithm) != expected.cend())
+        );
+    }
+}
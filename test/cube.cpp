@@ -0,0 +1,339 @@
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <insertionfinder/algorithm.hpp>
+#include <insertionfinder/cube.hpp>
+#include <insertionfinder/twist.hpp>
+using std::size_t;
+using InsertionFinder::Cube;
+using InsertionFinder::CubeBatch;
+using InsertionFinder::Twist;
+
+
+namespace {
+    struct CubeValues {
+        std::array<unsigned, 8> corner;
+        std::array<unsigned, 12> edge;
+    };
+
+    CubeValues cube_values(const Cube& cube) {
+        std::stringstream stream;
+        cube.save_to(stream);
+        std::string data = stream.str();
+        CubeValues values;
+        for (size_t i = 0; i < 8; ++i) {
+            values.corner[i] = static_cast<unsigned char>(data[i]);
+        }
+        for (size_t i = 0; i < 12; ++i) {
+            values.edge[i] = static_cast<unsigned char>(data[i + 8]);
+        }
+        return values;
+    }
+
+    int reference_corner_cycles(const std::array<unsigned, 8>& corner) {
+        unsigned visited_mask = 0;
+        int self_orientation[3] = {0, 0, 0};
+        int even_permutation[3] = {0, 0, 0};
+        int odd_permutation[3] = {0, 0, 0};
+        int cycles = 0;
+        bool parity = false;
+
+        for (unsigned x = 0; x < 8; ++x) {
+            if ((visited_mask & (1 << x)) == 0) {
+                int length = -1;
+                unsigned orientation = 0;
+                unsigned y = x;
+                do {
+                    visited_mask |= 1 << y;
+                    ++length;
+                    orientation += corner[y];
+                    y = corner[y] / 3;
+                } while (y != x);
+                cycles += length >> 1;
+                orientation %= 3;
+                if (length == 0 && orientation) {
+                    ++self_orientation[orientation];
+                } else if ((length & 1) == 0 && orientation) {
+                    ++even_permutation[orientation];
+                } else if (length & 1) {
+                    parity = !parity;
+                    ++cycles;
+                    ++odd_permutation[orientation];
+                }
+            }
+        }
+
+        if (parity) {
+            --cycles;
+            if (odd_permutation[0]) {
+                --odd_permutation[0];
+            } else if (odd_permutation[1] < odd_permutation[2]) {
+                --odd_permutation[2];
+                ++even_permutation[2];
+            } else {
+                --odd_permutation[1];
+                ++even_permutation[1];
+            }
+        }
+
+        if (odd_permutation[1] < odd_permutation[2]) {
+            even_permutation[2] += odd_permutation[0] & 1;
+            even_permutation[1] += (odd_permutation[2] - odd_permutation[1]) >> 1;
+        } else {
+            even_permutation[1] += odd_permutation[0] & 1;
+            even_permutation[2] += (odd_permutation[1] - odd_permutation[2]) >> 1;
+        }
+
+        int x = self_orientation[1] + even_permutation[1];
+        int y = self_orientation[2] + even_permutation[2];
+        cycles += (x / 3 + y / 3) << 1;
+        int twists = x % 3;
+        return cycles + twists + (even_permutation[1] + even_permutation[2] < twists);
+    }
+
+    int reference_edge_cycles(const std::array<unsigned, 12>& edge) {
+        unsigned visited_mask = 0;
+        int self_flip = 0;
+        int even_flip = 0;
+        int odd_flip = 0;
+        int cycles = 0;
+        bool parity = false;
+
+        for (unsigned x = 0; x < 12; ++x) {
+            if ((visited_mask & (1 << x)) == 0) {
+                int length = -1;
+                bool flip = false;
+                unsigned y = x;
+                do {
+                    visited_mask |= 1 << y;
+                    ++length;
+                    flip ^= edge[y] & 1;
+                    y = edge[y] >> 1;
+                } while (y != x);
+                cycles += length >> 1;
+                if (length & 1) {
+                    parity = !parity;
+                    ++cycles;
+                }
+                if (flip) {
+                    if (length == 0) {
+                        ++self_flip;
+                    } else if (length & 1) {
+                        odd_flip ^= 1;
+                    } else {
+                        ++even_flip;
+                    }
+                }
+            }
+        }
+
+        even_flip += odd_flip;
+        if (self_flip < even_flip) {
+            cycles += (self_flip + even_flip) >> 1;
+        } else {
+            static constexpr int flip_cycles[7] = {0, 2, 3, 5, 6, 8, 9};
+            cycles += even_flip + flip_cycles[(self_flip - even_flip) >> 1];
+        }
+
+        return cycles - parity;
+    }
+
+    Cube random_cube(std::mt19937& generator) {
+        std::array<unsigned, 8> corner;
+        std::array<unsigned, 12> edge;
+        std::iota(corner.begin(), corner.end(), 0);
+        std::iota(edge.begin(), edge.end(), 0);
+        std::shuffle(corner.begin(), corner.end(), generator);
+        std::shuffle(edge.begin(), edge.end(), generator);
+        std::uniform_int_distribution<unsigned> orientation(0, 2);
+        std::uniform_int_distribution<unsigned> flip(0, 1);
+        std::string data(21, '\0');
+        for (size_t i = 0; i < 8; ++i) {
+            data[i] = corner[i] * 3 + orientation(generator);
+        }
+        for (size_t i = 0; i < 12; ++i) {
+            data[i + 8] = edge[i] << 1 | flip(generator);
+        }
+        std::stringstream stream(data);
+        Cube cube;
+        cube.read_from(stream);
+        return cube;
+    }
+
+    Cube sparse_cube(std::mt19937& generator) {
+        std::array<unsigned, 8> corner;
+        std::array<unsigned, 12> edge;
+        std::iota(corner.begin(), corner.end(), 0);
+        std::iota(edge.begin(), edge.end(), 0);
+        std::uniform_int_distribution<size_t> size(0, 3);
+        std::uniform_int_distribution<unsigned> orientation(0, 2);
+        std::uniform_int_distribution<unsigned> flip(0, 1);
+        std::array<unsigned, 8> corner_position = corner;
+        std::array<unsigned, 12> edge_position = edge;
+        std::shuffle(corner_position.begin(), corner_position.end(), generator);
+        std::shuffle(edge_position.begin(), edge_position.end(), generator);
+        size_t corner_size = size(generator);
+        size_t edge_size = size(generator);
+        std::string data(21, '\0');
+        for (size_t i = 0; i < 8; ++i) {
+            data[i] = corner[i] * 3;
+        }
+        for (size_t i = 0; i < 12; ++i) {
+            data[i + 8] = edge[i] << 1;
+        }
+        for (size_t i = 0; i < corner_size; ++i) {
+            data[corner_position[i]] = corner_position[(i + 1) % corner_size] * 3 + orientation(generator);
+        }
+        for (size_t i = 0; i < edge_size; ++i) {
+            data[edge_position[i] + 8] = edge_position[(i + 1) % edge_size] << 1 | flip(generator);
+        }
+        std::stringstream stream(data);
+        Cube cube;
+        cube.read_from(stream);
+        return cube;
+    }
+
+    // Runs f once with each kernel set the CPU supports, then restores the one picked at startup.
+    template<class F> void for_each_kernel_set(const F& f) {
+        const std::string original = Cube::kernel_name();
+        for (const char* name: {"scalar", "sse4", "avx2"}) {
+            if (!Cube::select_kernels(name)) {
+                BOOST_TEST_MESSAGE("Kernel set " << name << " is not supported, skipped");
+                continue;
+            }
+            BOOST_TEST_REQUIRE(std::string(Cube::kernel_name()) == name);
+            BOOST_TEST_CONTEXT("kernel set " << name) {
+                f();
+            }
+        }
+        Cube::select_kernels(original.c_str());
+    }
+
+    Cube reference_best_placement(const Cube& cube) {
+        Cube original_cube = cube;
+        original_cube.rotate(cube.placement().inverse());
+        int best_cycles = original_cube.corner_cycles() + original_cube.edge_cycles() + original_cube.has_parity();
+        if (best_cycles <= 4) {
+            return original_cube;
+        }
+        Cube best_cube = original_cube;
+        for (int rotation: {2, 8, 10, 5, 7, 13, 15, 17, 19, 21, 23, 1, 3, 4, 12, 16, 20, 6, 9, 11, 14, 18, 22}) {
+            Cube placed_cube = original_cube;
+            placed_cube.rotate(rotation);
+            int cycles = placed_cube.corner_cycles() + placed_cube.edge_cycles();
+            if (Cube::center_cycles[rotation] <= 1) {
+                cycles += placed_cube.has_parity();
+            }
+            if (cycles <= 4) {
+                return placed_cube;
+            }
+            if (cycles + Cube::center_cycles[rotation] < best_cycles) {
+                best_cube = placed_cube;
+                best_cycles = cycles + Cube::center_cycles[rotation];
+            }
+        }
+        return best_cube;
+    }
+};
+
+
+BOOST_AUTO_TEST_CASE(cube_cycles_of_random_states) {
+    for_each_kernel_set([] {
+        std::mt19937 generator(2019);
+        for (size_t i = 0; i < 100000; ++i) {
+            Cube cube = random_cube(generator);
+            CubeValues values = cube_values(cube);
+            BOOST_TEST_REQUIRE(cube.corner_cycles() == reference_corner_cycles(values.corner));
+            BOOST_TEST_REQUIRE(cube.edge_cycles() == reference_edge_cycles(values.edge));
+        }
+    });
+}
+
+BOOST_AUTO_TEST_CASE(cube_cycles_of_scrambled_states) {
+    for_each_kernel_set([] {
+        std::mt19937 generator(2019);
+        std::uniform_int_distribution<unsigned> twist_distribution(0, 23);
+        Cube cube;
+        for (size_t i = 0; i < 100000; ++i) {
+            Twist twist = twist_distribution(generator);
+            if (twist & 3) {
+                cube.twist(twist);
+            }
+            CubeValues values = cube_values(cube);
+            BOOST_TEST_REQUIRE(cube.corner_cycles() == reference_corner_cycles(values.corner));
+            BOOST_TEST_REQUIRE(cube.edge_cycles() == reference_edge_cycles(values.edge));
+        }
+    });
+}
+
+BOOST_AUTO_TEST_CASE(cube_batch_cycles) {
+    for_each_kernel_set([] {
+        std::mt19937 generator(2019);
+        std::vector<Cube> cubes;
+        for (size_t i = 0; i < 256; ++i) {
+            cubes.push_back(i % 4 ? sparse_cube(generator) : random_cube(generator));
+        }
+        CubeBatch batch(cubes);
+        CubeBatch::Result result;
+        std::uniform_int_distribution<unsigned> flag_distribution(0, 3);
+        for (size_t i = 0; i < 1000; ++i) {
+            Cube state = i % 2 ? random_cube(generator) : sparse_cube(generator) * sparse_cube(generator);
+            std::vector<std::byte> flags;
+            for (size_t index = 0; index < cubes.size(); ++index) {
+                flags.push_back(static_cast<std::byte>(flag_distribution(generator)));
+            }
+            batch.twist_before(state, result, [&](size_t index) {return flags[index];});
+            for (size_t index = 0; index < cubes.size(); ++index) {
+                Cube cube = state * cubes[index];
+                if (static_cast<bool>(flags[index] & InsertionFinder::CubeTwist::corners)) {
+                    BOOST_TEST_REQUIRE(result.get_corner_cycles(index) == cube.corner_cycles());
+                }
+                if (static_cast<bool>(flags[index] & InsertionFinder::CubeTwist::edges)) {
+                    BOOST_TEST_REQUIRE(result.get_edge_cycles(index) == cube.edge_cycles());
+                }
+            }
+        }
+    });
+}
+
+BOOST_AUTO_TEST_CASE(cube_best_placement) {
+    for_each_kernel_set([] {
+        std::mt19937 generator(2019);
+        for (size_t i = 0; i < 20000; ++i) {
+            Cube cube = i % 2 ? random_cube(generator) : sparse_cube(generator) * sparse_cube(generator);
+            cube.rotate(i % 24);
+            BOOST_TEST_REQUIRE((cube.best_placement() == reference_best_placement(cube)));
+        }
+    });
+}
+
+BOOST_AUTO_TEST_CASE(cube_equality_and_hash) {
+    for_each_kernel_set([] {
+        std::mt19937 generator(2019);
+        std::vector<Cube> cubes;
+        std::vector<std::string> data;
+        for (size_t i = 0; i < 1000; ++i) {
+            Cube cube = i % 2 ? random_cube(generator) : sparse_cube(generator);
+            cube.rotate(i % 24);
+            std::stringstream stream;
+            cube.save_to(stream);
+            cubes.push_back(cube);
+            data.push_back(stream.str());
+        }
+        std::hash<Cube> hash;
+        for (size_t i = 0; i < cubes.size(); ++i) {
+            Cube copy = cubes[i];
+            BOOST_TEST_REQUIRE((copy == cubes[i]));
+            BOOST_TEST_REQUIRE(hash(copy) == hash(cubes[i]));
+            for (size_t j = 0; j < i; ++j) {
+                BOOST_TEST_REQUIRE((cubes[i] == cubes[j]) == (data[i] == data[j]));
+            }
+        }
+    });
+}
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Generated algorithm files must not depend on how the lines are split between the threads, nor on how many sorted
+# runs the out-of-core generation spills.
+set -e
+insertionfinder=../src/insertionfinder
+directory=$(mktemp -d)
+trap 'rm -rf "$directory"' EXIT
+
+set --
+for file in "${srcdir:-.}"/../data/algorithms/*.txt; do
+    set -- "$@" -f "$file"
+done
+
+for version in 1 2; do
+    $insertionfinder --generate --algs-version $version --jobs=1 "$@" -a "$directory/serial.algs"
+    $insertionfinder --generate --algs-version $version --jobs=4 "$@" -a "$directory/parallel.algs"
+    cmp "$directory/serial.algs" "$directory/parallel.algs"
+
+    $insertionfinder --generate --algs-version $version --jobs=4 --memory-limit=1 --verbose "$@" \
+        -a "$directory/out-of-core.algs" 2> "$directory/out-of-core.log"
+    runs=$(sed -n 's/^Merging \([0-9]*\) sorted runs$/\1/p' "$directory/out-of-core.log")
+    test "${runs:-0}" -gt 1
+    cmp "$directory/serial.algs" "$directory/out-of-core.algs"
+done